@@ -19,15 +19,35 @@
 
 set -o nounset                              # Treat unset variables as an error
 
+GAMES=1 # concurrent games per configuration, sharing a weight pool
+while getopts "k:" flag; do
+    case "$flag" in
+        k) GAMES="$OPTARG" ;;
+    esac
+done
+shift $((OPTIND - 1))
+
 NPROC=`nproc`
-N=`expr $NPROC / 2  - 1`
+N=`expr $NPROC / \( 2 \* $GAMES \) - 1`
 
 make clean
 make -j `nproc` release
 
 exec 1>console.log 2>&1                                                              
 
-./train.sh -b none -sf -g 1.0 -L 0.5 -A 0.125 -I 0.5 $* & #hamq
+train() {
+    if [ $GAMES -gt 1 ]; then
+        pool=`echo "$@" | md5sum | cut -c 1-8`
+        for game in `seq $GAMES`; do
+            ./train.sh -b none -sf "$@" -W $pool -G $game $ARGS &
+        done
+    else
+        ./train.sh -b none -sf "$@" $ARGS &
+    fi
+}
+
+ARGS="$*"
+train -g 1.0 -L 0.5 -A 0.125 -I 0.5 #hamq
 
 gamma=1.0
 
@@ -36,7 +56,7 @@ for i in `seq $N`; do
     alpha=$(python -c "import random; print('{:.3f}'.format(random.uniform(0.001, 0.25)))")
     initialweight=$(python -c "import random; print('{:.3f}'.format(random.uniform(0.0, 1.0)))")
 
-    ./train.sh -b none -sf -g $gamma -L $lambda -A $alpha -I $initialweight $* & #hamq
+    train -g $gamma -L $lambda -A $alpha -I $initialweight #hamq
 done
 
 wait
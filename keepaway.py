@@ -25,8 +25,8 @@ def ensure_parent_dir(name):
         makedirs(parent)
 
 
-def launch_player(player_type, index, options):
-    """Launcher for both keepers and takers."""
+def launch_player(player_type, index, options, threads = 0):
+    """Launcher for both keepers and takers (threads of one process if set)."""
     from itertools import chain
     from subprocess import Popen
 
@@ -41,7 +41,18 @@ def launch_player(player_type, index, options):
         I = float(options.initial_weight),
         z = int(options.hierarchical_fsm),
         Q = int(options.qlearning),
+        M = options.memory_size,
+        F = int(options.single_precision),
+        B = options.barrier_timeout,
+        C = options.checkpoint_episodes,
+        D = options.checkpoint_seconds,
+        K = options.checkpoint_keep,
+        E = int(options.decentralized),
+        P = int(options.huge_pages),
+        S = options.seed,
+        Y = int(options.trace_cycles),
         l = options.log_level, # log level
+        b = options.log_buffer,
         o = 'logs/{}_{}_{}.log'.format(player_type, options.label, index + 1),
         e = int(getattr(options, player_type + '_learn')),
         j = options.taker_count,
@@ -50,6 +61,16 @@ def launch_player(player_type, index, options):
         q = getattr(options, player_type + '_policy'),
         t = player_type + 's', # Pluralize for team name. TODO Really?
     )
+    if threads:
+        player_options['T'] = threads
+    if options.record_transitions:
+        player_options['R'] = 'logs/{}_{}.trn'.format(player_type, options.label)
+    if options.record_events:
+        player_options['V'] = 'logs/{}_{}.evt'.format(player_type, options.label)
+    if options.weight_pool:
+        player_options['H'] = options.weight_pool
+    if options.checkpoint_deltas is not None:
+        player_options['N'] = options.checkpoint_deltas
 
     # Handle optional args.
     def put_player_file(key, name):
@@ -319,6 +340,11 @@ def parse_options(args = None, **defaults):
     parser.add_option(
         '--log-level', type = 'int', default = 0,
         help = "Text log level.")
+    parser.add_option(
+        '--log-buffer', type = 'int', default = 0, metavar = 'MB',
+        help = "Write text logs from a writer thread through a buffer of MB "
+            "megabytes, dropping messages when it is full (0 to write "
+            "them synchronously).")
     parser.add_option(
         '--fullstate', action = 'store_true', default = False,
         help = "Use fullstate information for left and right.")
@@ -343,6 +369,59 @@ def parse_options(args = None, **defaults):
     parser.add_option(
         '--initial-weight', type = 'float', default = 0.0,
         help = "Initial weight values.")
+    parser.add_option(
+        '--memory-size', type = 'int', default = 2 << 20,
+        help = "Number of weights (power of 2).")
+    parser.add_option(
+        '--single-precision', action = 'store_true', default = False,
+        help = "Store weights and traces in single precision.")
+    parser.add_option(
+        '--threads', action = 'store_true', default = False,
+        help = "Run all players of a team as threads of one process.")
+    parser.add_option(
+        '--barrier-timeout', type = 'int', default = 1000,
+        help = "Timeout (ms) of barriers among keepers (0 for none).")
+    parser.add_option(
+        '--checkpoint-episodes', type = 'int', default = 0,
+        help = "Checkpoint learned weights every so many episodes (0 for none).")
+    parser.add_option(
+        '--checkpoint-seconds', type = 'int', default = 0,
+        help = "Checkpoint learned weights every so many seconds (0 for none).")
+    parser.add_option(
+        '--checkpoint-keep', type = 'int', default = 3,
+        help = "Number of full checkpoints kept.")
+    parser.add_option(
+        '--checkpoint-deltas', type = 'int', default = None,
+        help = "Delta checkpoints (changed weights only) between full ones "
+            "(CHECKPOINT_DELTAS of the player if not given).")
+    parser.add_option(
+        '--decentralized', action = 'store_true', default = False,
+        help = "Let each non-learning player compute joint choices itself, "
+            "without barriers among keepers.")
+    parser.add_option(
+        '--seed', type = 'int', default = 0,
+        help = "Seed of exploration and tie breaking of the players, for "
+            "repeatable runs (0 for the time).")
+    parser.add_option(
+        '--trace-cycles', action = 'store_true', default = False,
+        help = "Time the sense-think-act loop of the players and report "
+            "latency histograms and missed cycles at exit.")
+    parser.add_option(
+        '--huge-pages', action = 'store_true', default = False,
+        help = "Back the shared learner memory by 2 MB huge pages, if the "
+            "kernel provides them.")
+    parser.add_option(
+        '--weight-pool', metavar = 'NAME',
+        help = "Learn into the weights shared by all concurrent games given "
+            "the same pool NAME (and hyperparameters).")
+    parser.add_option(
+        '--record-transitions', action = 'store_true', default = False,
+        help = "Record transitions of each team for offline replay.")
+    parser.add_option(
+        '--record-events', action = 'store_true', default = False,
+        help = "Record learner events (choice points, joint choices, Q "
+            "values, updates, barrier waits, episodes) of each team in "
+            "binary, for kwlogdump.")
 
     options = parser.parse_args(args)[0]
     # Set coach_port and online_coach_port here, if not set previously.
@@ -381,16 +460,23 @@ def run(options):
 
     # Then keepers.
     keeper_pids = []
-    for i in xrange(options.keeper_count):
-        keeper_pids.append(launch_player('keeper', i, options))
-        time.sleep(0.5)
+    if options.threads:
+        keeper_pids.append(
+            launch_player('keeper', 0, options, options.keeper_count))
+    else:
+        for i in xrange(options.keeper_count):
+            keeper_pids.append(launch_player('keeper', i, options))
+            time.sleep(0.5)
     # Watch for the team to make sure keepers are team 0.
     wait_for_players(options.port, 'keepers')
 
     # Then takers.
-    for i in xrange(options.taker_count):
-        launch_player('taker', i, options)
-        time.sleep(0.5)
+    if options.threads:
+        launch_player('taker', 0, options, options.taker_count)
+    else:
+        for i in xrange(options.taker_count):
+            launch_player('taker', i, options)
+            time.sleep(0.5)
     # Allow dispstart to kick off play.
     wait_for_players(options.port, 'takers', True)
 
@@ -84,6 +84,7 @@ ActHandler::ActHandler( Connection *c, WorldModel *wm, ServerSettings *ss )
   WM                  = wm;
 
   m_iMultipleCommands = 0;
+  m_timeLastSent      = -1;
   ACT                 = this; // needed to let signal call method from class
 }
 
@@ -112,14 +113,15 @@ bool ActHandler::isQueueEmpty()
     we don't want a clash (two commands in one cycle). In this case false is
     returned.
     \return true when sending of messages succeeded, false otherwise */
-bool ActHandler::sendCommands( )
+bool ActHandler::sendCommands( fsm::TraceThread thread )
 {
-  static Time timeLastSent = -1;
+  int64_t     traceStart   = fsm::CycleTrace::enabled ?
+                             fsm::CycleTrace::now() : 0;
   bool        bNoOneCycle  = false;
-  static char        strCommand[MAX_MSG];
+  char        *strCommand  = m_strCommand;
   strCommand[0]            = '\0';
 
-  if( WM->getCurrentTime() == timeLastSent )
+  if( WM->getCurrentTime() == m_timeLastSent )
   {
     Log.logFromSignal( 2, " already sent message; don't send" );
     return false;
@@ -169,7 +171,7 @@ bool ActHandler::sendCommands( )
   // send the string to the server (example string: (dash 100)(turn_neck -19))
   if( strCommand[0] != '\0' )
   {
-    timeLastSent        = WM->getCurrentTime();
+    m_timeLastSent        = WM->getCurrentTime();
 
 #if USE_DRAW_LOG
     LogDraw.logText( "command string", VecPosition( -25, 30 ), strCommand,
@@ -177,6 +179,9 @@ bool ActHandler::sendCommands( )
 #endif
 
     connection->sendMessage( strCommand );
+    if( fsm::CycleTrace::enabled )
+      WM->trace.record( thread, fsm::TRACE_SEND, WM->getCurrentCycle(),
+                        traceStart );
     Log.logFromSignal( 2, " send queued action to server: %s", strCommand);
   }
   else
@@ -254,7 +259,7 @@ bool ActHandler::putCommandInQueue( SoccerCommand command )
     \return true when message was sent, false otherwise */
 bool ActHandler::sendCommand( SoccerCommand soc )
 {
-  static char        strCommand[MAX_MSG];
+  char        strCommand[MAX_MSG];
   strCommand[0]            = '\0';
   soc.getCommandString( strCommand, SS );
   return sendMessage( strCommand );
@@ -292,7 +297,7 @@ bool ActHandler::sendMessage( char * str )
     \return true when message was sent, false otherwise */
 bool ActHandler::sendCommandDirect( SoccerCommand soc )
 {
-  static char        strCommand[MAX_MSG];
+  char        strCommand[MAX_MSG];
   strCommand[0]            = '\0';
   if( soc.commandType == CMD_ILLEGAL )
     return false;
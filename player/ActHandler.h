@@ -94,6 +94,8 @@ class ActHandler {
   SoccerCommand  m_queueMultipleCommands[CMD_MAX_COMMANDS];
                                          /*!< non primary commands*/
   int            m_iMultipleCommands;    /*!< number of non-primary commands */
+  Time           m_timeLastSent;         /*!< time queued commands were sent */
+  char           m_strCommand[MAX_MSG];  /*!< string of queued commands      */
 
 public:
   ActHandler( Connection* c, WorldModel *wm, ServerSettings *ss);
@@ -102,7 +104,8 @@ public:
   bool           putCommandInQueue( SoccerCommand command      );
   void           emptyQueue       (                            );
   bool           isQueueEmpty     (                            );
-  bool           sendCommands     (                            );
+  bool           sendCommands     ( fsm::TraceThread thread =
+                                    fsm::TRACE_ACT_THREAD      );
   SoccerCommand  getPrimaryCommand(                            );
 
   // methods to send commands directly to the server
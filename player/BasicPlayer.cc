@@ -52,6 +52,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "BasicPlayer.h"
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 FileLock::FileLock(const string &name) {
   static const timespec sleepTime = {0, 1 * 1000 * 1000}; //1ms
@@ -77,87 +80,97 @@ ScopedLock::~ScopedLock() {
   if (sem) sem_post(sem);
 }
 
-Barrier::Barrier(int n, size_t hash, const string name) : n(n), name(name), count(0), wait_id(0) {
-  sharedMemory["shm"] = "/" + name + "::count-" + to_string(hash) + ".shm";
-  int shm_fd = shm_open(sharedMemory["shm"].c_str(), O_CREAT | O_RDWR, 0666);
-  if (shm_fd == -1) {
-    printf("prod: Shared memory failed: %s\n", strerror(errno));
-    exit(1);
-  }
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
 
-  ftruncate(shm_fd, sizeof(int));
-  if ((count = (int *) mmap(0, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0)) == MAP_FAILED) {
-    PRINT_VALUE("mmap");
-    PRINT_VALUE(strerror(errno));
-    exit(1);
-  }
+static long futex(unsigned *addr, int op, unsigned val,
+                  const timespec *timeout) {
+  return syscall(SYS_futex, addr, op, val, timeout, 0, 0);
+}
 
-  sharedMemory["mutex"] = "/" + name + "::mutex-" + to_string(hash);
-  if ((mutex = sem_open(sharedMemory["mutex"].c_str(), O_CREAT, 0666, 1)) == SEM_FAILED) {
-    PRINT_VALUE("sem_open mutex");
-    PRINT_VALUE(strerror(errno));
-    exit(1);
-  }
+void Barrier::reset() {
+  __atomic_store_n(&state, 0u, __ATOMIC_SEQ_CST);
+  __atomic_store_n(&sleepers, 0, __ATOMIC_SEQ_CST);
+  waits = 0;
+  timeouts = 0;
+}
 
-  sharedMemory["turnstile"] = "/" + name + "::turnstile-" + to_string(hash);
-  if ((turnstile = sem_open(sharedMemory["turnstile"].c_str(), O_CREAT, 0666, 0)) == SEM_FAILED) {
-    PRINT_VALUE("sem_open turnstile");
-    PRINT_VALUE(strerror(errno));
-    exit(1);
+/**
+ * wait for n parties (including this one)
+ * on timeout, the arrival is withdrawn (if the barrier has not opened meanwhile)
+ * @param n
+ * @param ms timeout in ms (no timeout if not positive)
+ * @return false on timeout
+ */
+bool Barrier::wait(int n, int ms) {
+  const unsigned mask = (1u << COUNT_BITS) - 1;
+  Assert(n > 0 && (unsigned) n <= mask);
+  __atomic_add_fetch(&waits, 1, __ATOMIC_RELAXED);
+
+  unsigned s = __atomic_fetch_add(&state, 1u, __ATOMIC_ACQ_REL);
+  unsigned sense = s >> COUNT_BITS;
+  if ((s & mask) + 1 == (unsigned) n) { // last one: reverse sense and count
+    __atomic_add_fetch(&state, (1u << COUNT_BITS) - n, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sleepers, __ATOMIC_SEQ_CST))
+      futex(&state, FUTEX_WAKE, INT_MAX, 0);
+    return true;
   }
 
-  sharedMemory["turnstile2"] = "/" + name + "::turnstile2-" + to_string(hash);
-  if ((turnstile2 = sem_open(sharedMemory["turnstile2"].c_str(), O_CREAT, 0666, 1)) == SEM_FAILED) {
-    PRINT_VALUE("sem_open turnstile2");
-    PRINT_VALUE(strerror(errno));
-    exit(1);
+  // spinning only helps if the other parties can run meanwhile
+  static const int spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPINS : 0;
+  for (int i = 0; i < spins; ++i) {
+    if (__atomic_load_n(&state, __ATOMIC_ACQUIRE) >> COUNT_BITS != sense)
+      return true;
+    cpuRelax();
   }
 
-  Log.log(101, "Barrier::Barrier n=%d", n);
-  Log.log(101, "Barrier::Barrier count=%d", *count);
-}
-
-void Barrier::phase1() {
-  {
-    ScopedLock lock(mutex);
-    *count += 1;
-    if (*count == n) {
-      SemTimedWait(turnstile2);
-      sem_post(turnstile);
-    }
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += ms / 1000;
+  deadline.tv_nsec += (ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec += 1;
+    deadline.tv_nsec -= 1000000000L;
   }
 
-  SemTimedWait(turnstile);
-  sem_post(turnstile);
-}
-
-void Barrier::phase2() {
-  {
-    ScopedLock lock(mutex);
-    *count -= 1;
-    if (*count == 0) {
-      SemTimedWait(turnstile);
-      sem_post(turnstile2);
+  __atomic_add_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+  for (;;) {
+    s = __atomic_load_n(&state, __ATOMIC_SEQ_CST);
+    if (s >> COUNT_BITS != sense) break;
+
+    timespec timeout = {0, 0};
+    if (ms > 0) {
+      timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      timeout.tv_sec = deadline.tv_sec - now.tv_sec;
+      timeout.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+      if (timeout.tv_nsec < 0) {
+        timeout.tv_sec -= 1;
+        timeout.tv_nsec += 1000000000L;
+      }
+      if (timeout.tv_sec < 0) { // withdraw
+        while (s >> COUNT_BITS == sense && (s & mask) > 0 &&
+               !__atomic_compare_exchange_n(&state, &s, s - 1, false,
+                                            __ATOMIC_SEQ_CST,
+                                            __ATOMIC_SEQ_CST))
+          continue;
+        if (s >> COUNT_BITS != sense) break; // opened meanwhile
+
+        __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&timeouts, 1, __ATOMIC_RELAXED);
+        LOG(101, "Barrier::wait timeout (n=%d)", n);
+        return false;
+      }
     }
-  }
-
-  SemTimedWait(turnstile2);
-  sem_post(turnstile2);
-}
 
-void Barrier::wait() {
-  SCOPED_LOG
-  int id = wait_id++;
-  Log.log(101, "Barrier::wait name=%s wait_id=%d", name.c_str(), id);
-  phase1();
-  phase2();
-}
+    futex(&state, FUTEX_WAIT, s, ms > 0 ? &timeout : 0);
+  }
 
-Barrier::~Barrier() {
-  shm_unlink(sharedMemory["shm"].c_str());
-  sem_unlink(sharedMemory["mutex"].c_str());
-  sem_unlink(sharedMemory["turnstile"].c_str());
-  sem_unlink(sharedMemory["turnstile2"].c_str());
+  __atomic_sub_fetch(&sleepers, 1, __ATOMIC_SEQ_CST);
+  return true;
 }
 
 /********************** LOW-LEVEL SKILLS *************************************/
@@ -288,9 +301,9 @@ SoccerCommand BasicPlayer::turnNeckToPoint(VecPosition pos, SoccerCommand soc) {
     the current speed of the agent.
     \return SoccerCommand that searches for the ball. */
 SoccerCommand BasicPlayer::searchBall() {
-  static Time timeLastSearch;
-  static SoccerCommand soc;
-  static int iSign = 1;
+  static thread_local Time timeLastSearch;
+  static thread_local SoccerCommand soc;
+  static thread_local int iSign = 1;
   VecPosition posBall = WM->getBallPos();
   VecPosition posAgent = WM->getAgentGlobalPosition();
   AngDeg angBall = (posBall - WM->getAgentGlobalPosition()).getDirection();
@@ -1501,15 +1514,15 @@ SoccerCommand BasicPlayer::intercept(bool isGoalie) {
   SoccerCommand soc = (isGoalie) ? interceptCloseGoalie() : interceptClose(), soc2;
 
   if (soc.commandType != CMD_ILLEGAL && isGoalie) {
-    Log.log(101, "intercept in two cycles");
+    LOG(101, "intercept in two cycles");
     return soc;
   }
 
-  Log.log(101, "start intercept, obj %d", WM->getAgentObjectType());
+  LOG(101, "start intercept, obj %d", WM->getAgentObjectType());
   soc2 = WM->predictCommandToInterceptBall(WM->getAgentObjectType(), soc);
 
   if (soc2.isIllegal()) {
-    Log.log(101, "soc2 illegal");
+    LOG(101, "soc2 illegal");
     return moveToPos(WM->getBallPos(), 30.0);
   }
 
@@ -2277,8 +2290,8 @@ VecPosition BasicPlayer::getThroughPassShootingPoint(ObjectT objTeam,
     \return position to intercept the ball. */
 VecPosition BasicPlayer::getInterceptionPointBall(int *iMinCyclesBall,
                                                   bool isGoalie) {
-  static Time timeLastMinCycles(-1, 0);
-  static Time timeLastIntercepted(-1, 0);
+  static thread_local Time timeLastMinCycles(-1, 0);
+  static thread_local Time timeLastIntercepted(-1, 0);
   VecPosition posPred = WM->getAgentGlobalPosition();
   VecPosition velMe = WM->getAgentGlobalVelocity();
   double dSpeed, dDistExtra;
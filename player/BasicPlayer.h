@@ -56,6 +56,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ActHandler.h"
 #include <semaphore.h>
+#include <limits>
 #include <stdio.h>
 #include <errno.h>
 #include <stdlib.h>
@@ -73,11 +74,11 @@ extern Logger Log; /*!< This is a reference to Logger to write log info to*/
 
 struct EntryRaiiObject {
   EntryRaiiObject(const char *f) : f_(f) {
-    Log.log(101, "Entered into >> %s", f_);
+    LOG(101, "Entered into >> %s", f_);
   }
 
   ~EntryRaiiObject() {
-    Log.log(101, "Exited from << %s", f_);
+    LOG(101, "Exited from << %s", f_);
   }
 
   const char *f_;
@@ -104,28 +105,23 @@ public:
   ~ScopedLock();
 };
 
-class Barrier {
-public:
-  Barrier(int n, size_t hash, const string name);
-
-  ~Barrier();
+/**
+ * sense-reversing barrier for processes (or threads) sharing its memory:
+ * waiters spin for a while, then sleep on a futex
+ * a zero-filled Barrier is ready to use
+ */
+struct Barrier {
+  static const int SPINS = 4096;
+  static const unsigned COUNT_BITS = 8; // no more than 255 parties
 
-  void wait();
+  unsigned state; // sense (generation) << COUNT_BITS | number of arrived
+  int sleepers;
+  long waits;
+  long timeouts;
 
-private:
-  void phase1();
+  void reset();
 
-  void phase2();
-
-private:
-  int n;
-  string name;
-  int *count;
-  sem_t *mutex;
-  sem_t *turnstile;
-  sem_t *turnstile2;
-  int wait_id;
-  unordered_map<string, string> sharedMemory;
+  bool wait(int n, int ms = 1000); // false on timeout
 };
 
 inline void SemTimedWait(sem_t *sem, int ms = 1000) {
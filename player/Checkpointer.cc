@@ -0,0 +1,361 @@
+#include "Checkpointer.h"
+#include "gzstream.h"
+#include <dirent.h>
+#include <algorithm>
+
+extern Logger Log;
+
+namespace fsm {
+
+const char *DeltaHeader::MAGIC = "KWQ-DLT";
+
+void DeltaHeader::setup(int memory_size, Precision prec, int num_pages,
+                        const collision_table &ct) {
+  memset(this, 0, sizeof(DeltaHeader));
+  memcpy(magic, MAGIC, sizeof(magic));
+  version = VERSION;
+  memorySize = memory_size;
+  precision = prec;
+  pageBits = collision_table::PAGE_BITS;
+  numPages = num_pages;
+  colTabSafe = ct.safe;
+  colTabCalls = ct.calls;
+  colTabClearhits = ct.clearhits;
+  colTabCollisions = ct.collisions;
+}
+
+bool DeltaHeader::valid() const {
+  return strncmp(magic, MAGIC, sizeof(magic)) == 0 &&
+         version > 0 && version <= VERSION && memorySize > 0 &&
+         (precision == PRECISION_FLOAT || precision == PRECISION_DOUBLE) &&
+         pageBits == collision_table::PAGE_BITS && numPages >= 0 &&
+         numPages <= collision_table::pages(memorySize);
+}
+
+/**
+ * number of slots in page p
+ */
+static int pageSlots(int p, int memorySize) {
+  return min(1 << collision_table::PAGE_BITS,
+             memorySize - (p << collision_table::PAGE_BITS));
+}
+
+Checkpointer::Checkpointer(const string &filename_, int episodes_,
+                           int seconds_, int keep_, int deltas_)
+    : filename(filename_), episodes(episodes_), seconds(seconds_),
+      keep(max(keep_, 1)), deltas(max(deltas_, 0)), numDeltas(-1),
+      numEpisodes(0), lastTime(std::chrono::steady_clock::now()), skipped(0),
+      delta(false), memorySize(0), precision(PRECISION_DOUBLE), offset(0.0),
+      pending(false), failed(false), done(false) {
+  auto seqs = list(filename);
+  seq = seqs.empty() ? 0 : seqs.back().first; // continue numbering if resumed
+  writer = std::thread(&Checkpointer::run, this);
+}
+
+Checkpointer::~Checkpointer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  cond.notify_one();
+  writer.join(); // the pending checkpoint (if any) is written
+
+  if (skipped) {
+    cerr << "Checkpoints skipped while writing: " << skipped << endl;
+  }
+}
+
+/**
+ * count an episode, and take a snapshot if a checkpoint is due
+ * @param weights
+ * @param memorySize
+ * @param colTab
+ */
+void Checkpointer::endEpisode(const RealArray &weights, int memorySize,
+                              collision_table *colTab) {
+  numEpisodes += 1;
+
+  bool due = episodes > 0 && numEpisodes >= episodes;
+  if (!due && seconds > 0) {
+    due = std::chrono::steady_clock::now() - lastTime >=
+          std::chrono::seconds(seconds);
+  }
+  if (!due) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending) {
+      skipped += 1;
+      LOG(101, "Checkpointer::endEpisode still writing, skipped");
+      return;
+    }
+    if (failed) { // the chain is broken: next one is full
+      numDeltas = -1;
+      failed = false;
+    }
+  }
+
+  // the first checkpoint is full, since earlier changes are not tracked here
+  if (numDeltas < 0 || numDeltas >= deltas || !colTab->dirty()) {
+    snapshot(weights, memorySize, colTab);
+    numDeltas = 0;
+  } else {
+    snapshotDelta(weights, memorySize, colTab);
+    numDeltas += 1;
+  }
+  numEpisodes = 0;
+  lastTime = std::chrono::steady_clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending = true;
+  }
+  cond.notify_one();
+}
+
+void Checkpointer::snapshot(const RealArray &weights_, int memorySize_,
+                            collision_table *colTab_) {
+  delta = false;
+  memorySize = memorySize_;
+  precision = weights_.getPrecision();
+  offset = weights_.getOffset();
+  weights.resize((size_t) memorySize * precision);
+  memcpy(weights.data(), weights_.raw(), weights.size());
+
+  colTabEntries.resize((size_t) colTab_->size);
+  colTab.attach(colTabEntries.data(), colTab_->size);
+  colTab.restore(colTab_->data(), false, false, colTab_->safe,
+                 colTab_->calls, colTab_->clearhits, colTab_->collisions);
+  colTab.probing = colTab_->probing;
+
+  if (colTab_->dirty())
+    memset(colTab_->dirty(), 0, (size_t) collision_table::pages(memorySize));
+}
+
+/**
+ * copy pages touched since the last snapshot
+ */
+void Checkpointer::snapshotDelta(const RealArray &weights_, int memorySize_,
+                                 collision_table *colTab_) {
+  delta = true;
+  memorySize = memorySize_;
+  precision = weights_.getPrecision();
+  offset = weights_.getOffset();
+  weights.clear();
+  colTabEntries.clear();
+  pages.clear();
+
+  unsigned char *dirty = colTab_->dirty();
+  for (int p = 0; p < collision_table::pages(memorySize); ++p) {
+    if (!dirty[p]) continue;
+    dirty[p] = 0;
+
+    long first = (long) p << collision_table::PAGE_BITS;
+    int n = pageSlots(p, memorySize);
+    const char *w = (const char *) weights_.raw() + first * precision;
+    weights.insert(weights.end(), w, w + (long) n * precision);
+    colTabEntries.insert(colTabEntries.end(), colTab_->data() + first,
+                         colTab_->data() + first + n);
+    pages.push_back(p);
+  }
+
+  colTab.restoreStats(colTab_->safe, colTab_->calls, colTab_->clearhits,
+                      colTab_->collisions);
+}
+
+void Checkpointer::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    cond.wait(lock, [this]() { return pending || done; });
+    if (!pending) return;
+
+    lock.unlock();
+    bool ok = write();
+    lock.lock();
+    pending = false;
+    failed = !ok;
+  }
+}
+
+/**
+ * write the staging buffer, then drop checkpoints older than the last keep
+ * full ones
+ */
+bool Checkpointer::write() {
+  seq += 1;
+  string file = name(filename, seq, delta);
+  string tmp = file + ".tmp";
+
+  ogzstream os;
+  os.open(tmp.c_str());
+  if (!os.good()) {
+    cerr << "failed to open checkpoint file: " << tmp << endl;
+    return false;
+  }
+
+  if (delta) {
+    writeDelta(os);
+  } else {
+    LinearSarsaLearner::writeWeights(os, weights.data(), memorySize,
+                                     precision, &colTab, offset);
+  }
+  os.close();
+  if (!os.good() || rename(tmp.c_str(), file.c_str()) == -1) {
+    cerr << "failed to write checkpoint file: " << file << endl;
+    unlink(tmp.c_str());
+    return false;
+  }
+
+  auto seqs = list(filename);
+  int numFull = 0;
+  long oldest = 0; // oldest full checkpoint kept
+  for (auto it = seqs.rbegin(); it != seqs.rend() && numFull < keep; ++it) {
+    if (!it->second) {
+      numFull += 1;
+      oldest = it->first;
+    }
+  }
+  for (auto &s : seqs) {
+    if (s.first < oldest) unlink(name(filename, s.first, s.second).c_str());
+  }
+  return true;
+}
+
+void Checkpointer::writeDelta(ostream &os) {
+  DeltaHeader header;
+  header.setup(memorySize, precision, (int) pages.size(), colTab);
+  os.write((char *) &header, sizeof(DeltaHeader));
+
+  const char *w = weights.data();
+  const int *e = colTabEntries.data();
+  for (auto p : pages) {
+    int n = pageSlots(p, memorySize);
+    os.write((char *) &p, sizeof(int));
+    LinearSarsaLearner::writeReals(os, w, n, precision, offset);
+    os.write((const char *) e, (long) n * sizeof(int));
+    w += (long) n * precision;
+    e += n;
+  }
+}
+
+/**
+ * apply a delta checkpoint on top of the checkpoint chain it follows
+ * @param file
+ * @param weights
+ * @param memorySize
+ * @param colTab
+ * @return
+ */
+bool Checkpointer::applyDelta(const string &file, RealArray &weights,
+                              int memorySize, collision_table *colTab) {
+  igzstream is;
+  is.open(file.c_str());
+  if (!is.good()) {
+    cerr << "failed to open checkpoint file: " << file << endl;
+    return false;
+  }
+
+  DeltaHeader header;
+  is.read((char *) &header, sizeof(DeltaHeader));
+  if (!header.valid() || header.memorySize != memorySize) {
+    cerr << "invalid delta checkpoint file: " << file << endl;
+    return false;
+  }
+
+  for (int i = 0; i < header.numPages; ++i) {
+    int p = -1;
+    is.read((char *) &p, sizeof(int));
+    if (!is.good() || p < 0 || p >= collision_table::pages(memorySize)) {
+      cerr << "truncated delta checkpoint file: " << file << endl;
+      return false;
+    }
+
+    long first = (long) p << collision_table::PAGE_BITS;
+    int n = pageSlots(p, memorySize);
+    LinearSarsaLearner::readReals(is, weights, (int) first, n,
+                                  (Precision) header.precision);
+    colTab->readEntries(is, first, n, header.version < 2, header.version < 3);
+  }
+
+  colTab->restoreStats(header.colTabSafe, header.colTabCalls,
+                       header.colTabClearhits, header.colTabCollisions);
+  colTab->used = colTab->usage();
+  is.close();
+  return true;
+}
+
+string Checkpointer::name(const string &filename, long seq, bool delta) {
+  return filename + ".ckpt" + to_string(seq) + (delta ? ".delta.gz" : ".gz");
+}
+
+/**
+ * checkpoints of filename (sequence number, is delta), in increasing order
+ * @param filename
+ * @return
+ */
+vector<pair<long, bool>> Checkpointer::list(const string &filename) {
+  auto slash = filename.rfind('/');
+  string dir = slash == string::npos ? "." : filename.substr(0, slash + 1);
+  string prefix = (slash == string::npos ? filename
+                                         : filename.substr(slash + 1)) + ".ckpt";
+
+  vector<pair<long, bool>> ret;
+  DIR *d = opendir(dir.c_str());
+  if (!d) return ret;
+
+  while (struct dirent *e = readdir(d)) {
+    string n = e->d_name;
+    if (n.length() <= prefix.length() + 3 ||
+        n.compare(0, prefix.length(), prefix) != 0 ||
+        n.compare(n.length() - 3, 3, ".gz") != 0)
+      continue;
+
+    string digits = n.substr(prefix.length(), n.length() - prefix.length() - 3);
+    bool delta = false;
+    if (digits.length() > 6 &&
+        digits.compare(digits.length() - 6, 6, ".delta") == 0) {
+      digits.resize(digits.length() - 6);
+      delta = true;
+    }
+    if (!digits.empty() &&
+        digits.find_first_not_of("0123456789") == string::npos) {
+      ret.push_back(make_pair(atol(digits.c_str()), delta));
+    }
+  }
+  closedir(d);
+
+  sort(ret.begin(), ret.end());
+  return ret;
+}
+
+/**
+ * the latest checkpoint chain of filename if newer than filename itself
+ * @param filename
+ * @return full checkpoint followed by its deltas, or empty
+ */
+vector<string> Checkpointer::latest(const string &filename) {
+  auto seqs = list(filename);
+  vector<string> ret;
+
+  long last = -1; // latest full checkpoint
+  for (auto &s : seqs) {
+    if (!s.second) last = s.first;
+  }
+  if (last < 0) return ret;
+
+  long expected = last;
+  for (auto &s : seqs) {
+    if (s.first < last) continue;
+    if (s.first != expected) break; // a delta is missing
+    ret.push_back(name(filename, s.first, s.second));
+    expected += 1;
+  }
+
+  struct stat ckpt, st;
+  if (stat(ret.back().c_str(), &ckpt) == -1 ||
+      (stat(filename.c_str(), &st) == 0 && st.st_mtime >= ckpt.st_mtime))
+    ret.clear();
+  return ret;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef KEEPAWAY_PLAYER_CHECKPOINTER_H
+#define KEEPAWAY_PLAYER_CHECKPOINTER_H
+
+#include "LinearSarsaLearner.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+namespace fsm {
+
+/**
+ * header of delta checkpoints: pages of weights and collision table entries
+ * changed since the previous checkpoint follow, each as its page index, its
+ * weights and its entries (64-bit before version 2, check values plus one
+ * from version 3)
+ */
+struct DeltaHeader {
+  char magic[8];
+  int version;
+  int memorySize;
+  int precision;
+  int pageBits;
+  int numPages;
+  int colTabSafe;
+  long colTabCalls;
+  long colTabClearhits;
+  long colTabCollisions;
+
+  static const char *MAGIC;
+  static const int VERSION = 3;
+
+  void setup(int memory_size, Precision prec, int num_pages,
+             const collision_table &ct);
+
+  bool valid() const;
+};
+
+/**
+ * periodic checkpoints of weights and collision table
+ *
+ * A snapshot is copied into a staging buffer by the learning thread, then
+ * compressed and written by a background thread as filename.ckptN.gz, keeping
+ * the last few of them. A snapshot due while the previous one is still being
+ * written is skipped instead of stalling the learner.
+ *
+ * Between full checkpoints, delta checkpoints (filename.ckptN.delta.gz) hold
+ * only the pages touched since the previous checkpoint; a full checkpoint and
+ * the deltas following it make a chain that is loaded in order.
+ */
+class Checkpointer {
+public:
+  Checkpointer(const string &filename, int episodes, int seconds, int keep,
+               int deltas);
+
+  ~Checkpointer();
+
+  void endEpisode(const RealArray &weights, int memorySize,
+                  collision_table *colTab);
+
+  static vector<string> latest(const string &filename);
+
+  static bool applyDelta(const string &file, RealArray &weights,
+                         int memorySize, collision_table *colTab);
+
+private:
+  void snapshot(const RealArray &weights, int memorySize,
+                collision_table *colTab);
+
+  void snapshotDelta(const RealArray &weights, int memorySize,
+                     collision_table *colTab);
+
+  void run();
+
+  bool write();
+
+  void writeDelta(ostream &os);
+
+  static string name(const string &filename, long seq, bool delta);
+
+  static vector<pair<long, bool>> list(const string &filename);
+
+  string filename;
+  int episodes; // episodes between checkpoints (0: none)
+  int seconds; // seconds between checkpoints (0: none)
+  int keep; // number of full checkpoints kept
+  int deltas; // delta checkpoints between full ones
+  long seq; // sequence number of the last checkpoint
+  int numDeltas; // since the last full checkpoint (-1: none yet)
+  int numEpisodes; // since the last checkpoint
+  std::chrono::steady_clock::time_point lastTime;
+  long skipped;
+
+  // staging buffer (owned by the writer while pending)
+  bool delta;
+  vector<char> weights; // all weights, or those of pages
+  int memorySize;
+  Precision precision;
+  double offset; // weights are stored relative to
+  vector<int> colTabEntries; // all entries, or those of pages
+  collision_table colTab;
+  vector<int> pages; // dirty pages (delta)
+
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool pending;
+  bool failed; // writing the last checkpoint failed
+  bool done;
+};
+
+}
+
+#endif //KEEPAWAY_PLAYER_CHECKPOINTER_H
@@ -17,28 +17,41 @@ template<class T>
 class ChoicePoint {
 public:
   ChoicePoint(const std::string &name, const std::vector<T> c)
-      : name(name), choices(c) {}
+      : name(name), choices(c), frame(MachineStateTable::ins().frame(name)) {
+    for (auto &choice : choices) {
+      choiceFrames.push_back(
+          MachineStateTable::ins().frame("[" + to_string(choice) + "]"));
+    }
+  }
 
   const string &getName() const { return name; }
 
-  T choose(int current_time) {
-    Log.log(101, "ChoicePoint::choose point name: %s", name.c_str());
-    auto i = LinearSarsaLearner::ins().step(current_time, (int) choices.size());
+  frame_id_t getFrame() const { return frame; }
 
-    if (i < choices.size()) {
-      Log.log(101, "ChoicePoint::choose my choice (agent %d): %s",
-              Memory::ins().agentIdx, to_string(choices[i]).c_str());
-    } else { // race condition?
-      Log.log(101, "ChoicePoint::choose i %d >= choices.size() %d", i,
-              choices.size());
-    }
+  /**
+   * choose an index into choices
+   */
+  int chooseIndex(int current_time) {
+    LOG(101, "ChoicePoint::choose point name: %s", name.c_str());
+    auto i = LinearSarsaLearner::ins().step(current_time, (int) choices.size());
+    Assert(i < choices.size()); // decisions are checked against choices
 
-    return i < choices.size() ? choices[i] : choices[0];
+    LOG(101, "ChoicePoint::choose my choice (agent %d): %s",
+        Memory::ins().agentIdx, to_string(choices[i]).c_str());
+    return i;
   }
 
+  T choose(int current_time) { return choices[chooseIndex(current_time)]; }
+
+  const T &get(int i) const { return choices[i]; }
+
+  frame_id_t getChoiceFrame(int i) const { return choiceFrames[i]; }
+
 private:
   std::string name;
   std::vector<T> choices;
+  frame_id_t frame;
+  std::vector<frame_id_t> choiceFrames;
 };
 
 /**
@@ -48,15 +61,16 @@ template<class T>
 class MakeChoice {
 public:
   MakeChoice(ChoicePoint<T> *cp) : cp(cp) {
-    Log.log(101, "MakeChoice::MakeChoice %s", cp->getName().c_str());
-    Memory::ins().PushStack(cp->getName());
+    LOG(101, "MakeChoice::MakeChoice %s", cp->getName().c_str());
+    Memory::ins().PushStack(cp->getFrame());
   }
 
   T operator()(int current_time) {
-    auto c = cp->choose(current_time);
-    Log.log(101, "MakeChoice::MakeChoice %s -> %s", cp->getName().c_str(),
-            to_string(c).c_str());
-    Memory::ins().PushStack("[" + to_string(c) + "]");
+    auto i = cp->chooseIndex(current_time);
+    auto &c = cp->get(i);
+    LOG(101, "MakeChoice::MakeChoice %s -> %s", cp->getName().c_str(),
+        to_string(c).c_str());
+    Memory::ins().PushStack(cp->getChoiceFrame(i));
     return c;
   }
 
@@ -75,8 +89,8 @@ private:
 class Run {
 public:
   Run(HierarchicalFSM *m) : m(m) {
-    Log.log(101, "Run::Run %s", m->getName().c_str());
-    Memory::ins().PushStack(m->getName());
+    LOG(101, "Run::Run %s", m->getName().c_str());
+    Memory::ins().PushStack(m->getFrame());
   }
 
   void operator()() { m->run(); }
@@ -89,10 +103,12 @@ private:
 
 class Action {
 public:
-  Action(HierarchicalFSM *m, vector<string> parameters = {}) : m(m) {
-    Log.log(101, "Action::Action with parameters=%s",
-            to_prettystring(parameters).c_str());
-    Memory::ins().PushStack("!" + to_prettystring(parameters));
+  Action(HierarchicalFSM *m, std::initializer_list<int> parameters = {})
+      : m(m) {
+    auto f = MachineStateTable::ins().actionFrame(parameters);
+    LOG(101, "Action::Action with parameters=%s",
+        MachineStateTable::ins().frameStr(f).c_str());
+    Memory::ins().PushStack(f);
   }
 
   void operator()() { m->action(); }
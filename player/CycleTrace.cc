@@ -0,0 +1,113 @@
+#include "CycleTrace.h"
+#include <algorithm>
+#include <chrono>
+
+namespace fsm {
+
+static const char *pointNames[TRACE_COUNT] = {
+    "receive", "update", "state", "step", "wait", "send"
+};
+
+bool CycleTrace::enabled = false;
+
+static thread_local CycleTrace *currentTrace = 0;
+
+int64_t CycleTrace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CycleTrace::setCurrent(CycleTrace *trace) {
+  currentTrace = trace;
+}
+
+CycleTrace *CycleTrace::current() {
+  return currentTrace;
+}
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0), buckets() {}
+
+void LatencyHistogram::add(int64_t duration) {
+  int64_t us = duration / 1000;
+  int b = 0;
+  while (b < BUCKETS - 1 && (int64_t(1) << b) <= us) ++b;
+  buckets[b] += 1;
+  count += 1;
+  sum += duration;
+  if (duration > max) max = duration;
+}
+
+int64_t LatencyHistogram::quantile(double q) const {
+  long n = 0;
+  for (int b = 0; b < BUCKETS; ++b) {
+    n += buckets[b];
+    if (n >= q * count) return int64_t(1) << b;
+  }
+  return int64_t(1) << (BUCKETS - 1);
+}
+
+void LatencyHistogram::print(FILE *out, const char *name) const {
+  if (count == 0) {
+    fprintf(out, "      %-8s -\n", name);
+    return;
+  }
+  fprintf(out, "      %-8s n %ld, mean %.1f us, p50 < %lld us, p99 < %lld us, "
+               "max %.1f us |", name, count, sum / 1000.0 / count,
+          (long long) quantile(0.5), (long long) quantile(0.99), max / 1000.0);
+  for (int b = 0; b < BUCKETS; ++b) {
+    if (buckets[b]) fprintf(out, " <%lld:%ld", (long long) 1 << b, buckets[b]);
+  }
+  fprintf(out, "\n");
+}
+
+CycleTrace::CycleTrace()
+    : cycles(0), missed(0), cycle(-1), cycleStart(0), sent(false) {}
+
+// when an event takes effect: a cycle starts with its first receive and is
+// answered once a send completes
+static int64_t effect(const TraceEvent &e) {
+  return e.point == TRACE_RECEIVE ? e.start : e.start + e.duration;
+}
+
+void CycleTrace::drain() {
+  // rings are merged in time order, so that sends find the cycle they answer
+  pending.clear();
+  for (auto &ring : rings) {
+    ring.drain([this](const TraceEvent &e) { pending.push_back(e); });
+  }
+  std::stable_sort(pending.begin(), pending.end(),
+                   [](const TraceEvent &a, const TraceEvent &b) {
+                     return effect(a) < effect(b);
+                   });
+  for (auto &e : pending) add(e);
+}
+
+void CycleTrace::add(const TraceEvent &e) {
+  points[e.point].add(e.duration);
+  if (e.point == TRACE_RECEIVE) {
+    if (e.cycle != cycle) { // first message of a cycle
+      if (cycle >= 0 && !sent) missed += 1;
+      cycles += 1;
+      cycle = e.cycle;
+      cycleStart = e.start;
+      sent = false;
+    }
+  } else if (e.point == TRACE_SEND && e.cycle == cycle && !sent) {
+    latency.add(e.start + e.duration - cycleStart);
+    sent = true;
+  }
+}
+
+void CycleTrace::report(FILE *out) {
+  drain();
+  unsigned dropped = 0;
+  for (auto &ring : rings) dropped += ring.getDropped();
+
+  fprintf(out, "   Cycles traced: %ld, missed: %ld (%f), events dropped: %u\n",
+          cycles, missed, cycles ? (double) missed / cycles * 100 : 0.0,
+          dropped);
+  latency.print(out, "cycle");
+  for (int p = 0; p < TRACE_COUNT; ++p) points[p].print(out, pointNames[p]);
+}
+
+}
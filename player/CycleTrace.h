@@ -0,0 +1,168 @@
+#ifndef KEEPAWAY_PLAYER_CYCLETRACE_H
+#define KEEPAWAY_PLAYER_CYCLETRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace fsm {
+
+/**
+ * trace points of the sense-think-act loop
+ */
+enum TracePoint {
+  TRACE_RECEIVE, // SenseHandler parsing a message
+  TRACE_UPDATE,  // WorldModel::updateAll
+  TRACE_STATE,   // HierarchicalFSM::getState
+  TRACE_STEP,    // LinearSarsaLearner::step (waits included)
+  TRACE_WAIT,    // a barrier wait of the learner
+  TRACE_SEND,    // ActHandler sending commands
+  TRACE_COUNT
+};
+
+/**
+ * threads recording trace points, each into its own ring
+ */
+enum TraceThread {
+  TRACE_SENSE_THREAD,
+  TRACE_THINK_THREAD,
+  TRACE_ACT_THREAD, // timer thread or alarm signal
+  TRACE_THREADS
+};
+
+struct TraceEvent {
+  int64_t start; // ns
+  int64_t duration; // ns
+  int cycle;
+  int point;
+};
+
+/**
+ * lock free ring of events with a single producer and a single consumer;
+ * events are dropped (and counted) when the consumer falls behind
+ */
+class TraceRing {
+public:
+  static const int SIZE = 1024;
+
+  TraceRing() : head(0), tail(0), dropped(0) {}
+
+  void push(const TraceEvent &e) {
+    unsigned h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SIZE) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    events[h % SIZE] = e;
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  template<class F>
+  void drain(F f) {
+    unsigned t = tail.load(std::memory_order_relaxed);
+    unsigned h = head.load(std::memory_order_acquire);
+    for (; t != h; ++t) f(events[t % SIZE]);
+    tail.store(t, std::memory_order_release);
+  }
+
+  unsigned getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  TraceEvent events[SIZE];
+  std::atomic<unsigned> head;
+  std::atomic<unsigned> tail;
+  std::atomic<unsigned> dropped;
+};
+
+/**
+ * histogram of durations in power of two buckets of microseconds
+ */
+struct LatencyHistogram {
+  static const int BUCKETS = 24; // up to 8 s
+
+  long count;
+  int64_t sum; // ns
+  int64_t max; // ns
+  long buckets[BUCKETS];
+
+  LatencyHistogram();
+
+  void add(int64_t duration);
+
+  // upper bound (us) of the bucket holding quantile q
+  int64_t quantile(double q) const;
+
+  void print(FILE *out, const char *name) const;
+};
+
+/**
+ * latency trace of the sense-think-act loop of an agent: the sense, think and
+ * act threads record timed trace points into their own rings, which the think
+ * thread drains into per point histograms each cycle; a cycle's latency runs
+ * from its first received message to the first command sent for it, and a
+ * cycle is missed when no command is sent before the next one is received
+ */
+class CycleTrace {
+public:
+  static bool enabled;
+
+  static int64_t now();
+
+  // trace of the agent of the calling (think) thread, for code without a
+  // WorldModel at hand
+  static void setCurrent(CycleTrace *trace);
+  static CycleTrace *current();
+
+  CycleTrace();
+
+  void record(TraceThread thread, TracePoint point, int cycle, int64_t start) {
+    rings[thread].push(TraceEvent{start, now() - start, cycle, point});
+  }
+
+  // called by the think thread only
+  void drain();
+
+  void report(FILE *out);
+
+private:
+  void add(const TraceEvent &e);
+
+  TraceRing rings[TRACE_THREADS];
+  std::vector<TraceEvent> pending;
+  LatencyHistogram points[TRACE_COUNT];
+  LatencyHistogram latency;
+  long cycles;
+  long missed;
+  int cycle; // last received
+  int64_t cycleStart;
+  bool sent;
+};
+
+/**
+ * times the scope it lives in as a trace point (nothing when disabled)
+ */
+class TraceSpan {
+public:
+  TraceSpan(CycleTrace *trace_, TraceThread thread_, TracePoint point_,
+            int cycle_ = 0)
+      : trace(CycleTrace::enabled ? trace_ : 0), thread(thread_),
+        point(point_), cycle(cycle_), start(trace ? CycleTrace::now() : 0) {}
+
+  ~TraceSpan() {
+    if (trace) trace->record(thread, point, cycle, start);
+  }
+
+  void setCycle(int cycle_) { cycle = cycle_; }
+
+private:
+  CycleTrace *trace;
+  TraceThread thread;
+  TracePoint point;
+  int cycle;
+  int64_t start;
+};
+
+}
+
+#endif //KEEPAWAY_PLAYER_CYCLETRACE_H
@@ -0,0 +1,311 @@
+#include "EventLog.h"
+#include "TransitionLog.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace fsm {
+
+static const EventSchema schemas[EVENT_TYPES] = {
+    {"none", 0, {}, {}},
+    {"episode_start", 0, {}, {}},
+    {"choice_point", 2, {"machine_state", "num_choices"}, {'u', 'u'}},
+    {"joint_choice", 3, {"machine_state", "choice", "tau"}, {'u', 'u', 's'}},
+    {"q_values", 1, {"q"}, {'l'}},
+    {"update", 2, {"delta", "traces"}, {'f', 'u'}},
+    {"barrier_wait", 3, {"barrier", "us", "timeout"}, {'u', 'u', 'u'}},
+    {"episode_end", 1, {"tau"}, {'s'}},
+};
+
+const EventSchema &EventSchema::of(int type) {
+  return schemas[type > 0 && type < EVENT_TYPES ? type : 0];
+}
+
+int EventSchema::named(const std::string &name) {
+  for (int t = 1; t < EVENT_TYPES; ++t) {
+    if (name == schemas[t].name) return t;
+  }
+  return 0;
+}
+
+const char *EventLogHeader::MAGIC = "KWQ-EVT";
+
+void EventLogHeader::setup(int num_teammates, const std::string &team_name) {
+  memset(this, 0, sizeof(EventLogHeader));
+  memcpy(magic, MAGIC, sizeof(magic));
+  version = VERSION;
+  numTeammates = num_teammates;
+  strncpy(teamName, team_name.c_str(), sizeof(teamName) - 1);
+}
+
+bool EventLogHeader::valid() const {
+  return strncmp(magic, MAGIC, sizeof(magic)) == 0 &&
+         version > 0 && version <= VERSION &&
+         numTeammates > 0 && numTeammates <= 11;
+}
+
+EventLog::EventLog() : fd(-1), in(0), agent(0), cycle(0), inEpisode(false) {
+  memset(&header, 0, sizeof(header));
+  memset(&block, 0, sizeof(block));
+}
+
+EventLog::~EventLog() { close(); }
+
+/**
+ * append to filename, which is created with header if it does not exist yet
+ * @param filename
+ * @param header_
+ * @return false if filename can not be written or is not an event log
+ */
+bool EventLog::openWrite(const std::string &filename,
+                         const EventLogHeader &header_) {
+  close();
+  header = header_;
+
+  fd = createWithHeader(filename, &header, sizeof(header));
+  if (fd == -1 && errno == EEXIST) { // shared with teammates, or appended to
+    EventLogHeader existing;
+    fd = open(filename.c_str(), O_RDWR | O_APPEND);
+    if (fd != -1 &&
+        (pread(fd, &existing, sizeof(existing), 0) != sizeof(existing) ||
+         !existing.valid())) {
+      std::cerr << "incompatible event log: " << filename << std::endl;
+      close();
+    }
+  }
+
+  if (fd == -1) {
+    std::cerr << "failed to open event log: " << filename << std::endl;
+    return false;
+  }
+  raw.reserve(BLOCK_SIZE + 1024);
+  return true;
+}
+
+bool EventLog::openRead(const std::string &filename) {
+  close();
+  in = fopen(filename.c_str(), "rb");
+  if (!in) {
+    std::cerr << "failed to open event log: " << filename << std::endl;
+    return false;
+  }
+
+  if (fread(&header, sizeof(header), 1, in) != 1 || !header.valid()) {
+    std::cerr << "invalid event log: " << filename << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void EventLog::close() {
+  flush();
+  if (fd != -1) ::close(fd);
+  if (in) fclose(in);
+  fd = -1;
+  in = 0;
+}
+
+void EventLog::setAgent(int agent_) {
+  if (agent_ != agent) flush();
+  agent = agent_;
+}
+
+void EventLog::putVarint(uint64_t v) {
+  while (v >= 0x80) {
+    raw.push_back((unsigned char) (v | 0x80));
+    v >>= 7;
+  }
+  raw.push_back((unsigned char) v);
+}
+
+void EventLog::putFloat(double v) {
+  float f = (float) v;
+  unsigned char b[sizeof(float)];
+  memcpy(b, &f, sizeof(float));
+  raw.insert(raw.end(), b, b + sizeof(float));
+}
+
+static uint64_t zigzag(int64_t v) {
+  return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+/**
+ * event layout: type, cycle (signed, relative to the previous event of the
+ * block, so that blocks decode on their own) and the fields of the type's
+ * schema; the first choice point of an episode is preceded by an episode
+ * start, and blocks end with episodes
+ */
+void EventLog::write(int type, int cycle_, EventField f0, EventField f1,
+                     EventField f2, const double *list, int n) {
+  if (fd == -1) return;
+  if (type == EVENT_CHOICE_POINT && !inEpisode) {
+    inEpisode = true;
+    write(EVENT_EPISODE_START, cycle_);
+  } else if (type == EVENT_EPISODE_END) {
+    inEpisode = false;
+  }
+
+  if (block.count == 0) {
+    block.firstCycle = block.lastCycle = cycle_;
+    block.types = 0;
+    cycle = 0;
+  }
+  block.firstCycle = std::min(block.firstCycle, cycle_);
+  block.lastCycle = std::max(block.lastCycle, cycle_);
+  block.types |= 1u << type;
+  block.count += 1;
+
+  putVarint((uint64_t) type);
+  putVarint(zigzag(cycle_ - cycle));
+  cycle = cycle_;
+
+  const EventSchema &schema = EventSchema::of(type);
+  EventField fields[EventSchema::MAX_FIELDS] = {f0, f1, f2};
+  for (int i = 0; i < schema.numFields; ++i) {
+    switch (schema.kinds[i]) {
+      case 'u': putVarint((uint64_t) fields[i].i); break;
+      case 's': putVarint(zigzag(fields[i].i)); break;
+      case 'f': putFloat(fields[i].x); break;
+      case 'l':
+        putVarint((uint64_t) n);
+        for (int j = 0; j < n; ++j) putFloat(list[j]);
+        break;
+    }
+  }
+
+  if (raw.size() >= BLOCK_SIZE || type == EVENT_EPISODE_END) flush();
+}
+
+/**
+ * append the events written so far as one deflated block
+ */
+void EventLog::flush() {
+  if (fd == -1 || block.count == 0) return;
+
+  uLongf size = compressBound((uLong) raw.size());
+  deflated.resize(sizeof(EventBlockHeader) + size);
+  if (compress2(deflated.data() + sizeof(EventBlockHeader), &size, raw.data(),
+                (uLong) raw.size(), Z_BEST_SPEED) != Z_OK) {
+    LOG(101, "EventLog::flush compression failed");
+  } else {
+    block.magic = EventBlockHeader::MAGIC;
+    block.agent = agent;
+    block.rawSize = (uint32_t) raw.size();
+    block.size = (uint32_t) size;
+    memcpy(deflated.data(), &block, sizeof(block));
+    size_t n = sizeof(EventBlockHeader) + size;
+    if (::write(fd, deflated.data(), n) != (ssize_t) n) {
+      LOG(101, "EventLog::flush failed: %s", strerror(errno));
+    }
+  }
+
+  raw.clear();
+  block.count = 0;
+}
+
+bool EventLog::nextBlock(EventBlockHeader &block_) {
+  if (!in) return false;
+  if (fread(&block_, sizeof(block_), 1, in) != 1) return false;
+  if (block_.magic != EventBlockHeader::MAGIC) {
+    std::cerr << "invalid event block" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void EventLog::skipBlock(const EventBlockHeader &block_) {
+  if (in) fseek(in, block_.size, SEEK_CUR);
+}
+
+static bool getVarint(const unsigned char *&p, const unsigned char *end,
+                      uint64_t &v) {
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7) {
+    unsigned char b = *p++;
+    v |= (uint64_t) (b & 0x7f) << shift;
+    if (!(b & 0x80)) return true;
+  }
+  return false;
+}
+
+static bool getFloat(const unsigned char *&p, const unsigned char *end,
+                     double &v) {
+  if (end - p < (ptrdiff_t) sizeof(float)) return false;
+  float f;
+  memcpy(&f, p, sizeof(float));
+  p += sizeof(float);
+  v = f;
+  return true;
+}
+
+static int64_t unzigzag(uint64_t v) {
+  return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/**
+ * inflate the block whose header was read last, and decode its events
+ */
+bool EventLog::readBlock(const EventBlockHeader &block_,
+                         std::vector<EventRecord> &records) {
+  records.clear();
+  if (!in) return false;
+  deflated.resize(block_.size);
+  raw.resize(block_.rawSize);
+  uLongf rawSize = block_.rawSize;
+  if (fread(deflated.data(), 1, block_.size, in) != block_.size ||
+      uncompress(raw.data(), &rawSize, deflated.data(), block_.size) != Z_OK ||
+      rawSize != block_.rawSize) {
+    std::cerr << "invalid event block" << std::endl;
+    return false;
+  }
+
+  const unsigned char *p = raw.data(), *end = p + rawSize;
+  int64_t cycle_ = 0;
+  records.resize(block_.count);
+  for (auto &r : records) {
+    uint64_t type, delta, v;
+    if (!getVarint(p, end, type) || !getVarint(p, end, delta)) return false;
+    cycle_ += unzigzag(delta);
+    r.agent = block_.agent;
+    r.type = (int) type;
+    r.cycle = (int) cycle_;
+    r.list.clear();
+
+    const EventSchema &schema = EventSchema::of(r.type);
+    for (int i = 0; i < schema.numFields; ++i) {
+      bool ok = true;
+      double x = 0.0;
+      switch (schema.kinds[i]) {
+        case 'u':
+          ok = getVarint(p, end, v);
+          r.fields[i] = EventField((unsigned long) v);
+          break;
+        case 's':
+          ok = getVarint(p, end, v);
+          r.fields[i] = EventField((long) unzigzag(v));
+          break;
+        case 'f':
+          ok = getFloat(p, end, x);
+          r.fields[i] = EventField(x);
+          break;
+        case 'l':
+          ok = getVarint(p, end, v);
+          r.list.resize(ok ? (size_t) v : 0);
+          for (auto &x : r.list) ok = ok && getFloat(p, end, x);
+          break;
+      }
+      if (!ok) {
+        std::cerr << "truncated event block" << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,159 @@
+#ifndef KEEPAWAY_PLAYER_EVENTLOG_H
+#define KEEPAWAY_PLAYER_EVENTLOG_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+namespace fsm {
+
+/**
+ * events of the learner, each with a fixed schema (see EventSchema)
+ */
+enum EventType {
+  EVENT_EPISODE_START = 1,
+  EVENT_CHOICE_POINT,
+  EVENT_JOINT_CHOICE,
+  EVENT_Q_VALUES,
+  EVENT_UPDATE,
+  EVENT_BARRIER_WAIT,
+  EVENT_EPISODE_END,
+  EVENT_TYPES
+};
+
+/**
+ * fields of an event type, each encoded as an unsigned ('u') or zigzag
+ * signed ('s') varint, a float ('f'), or a varint counted list of floats ('l')
+ */
+struct EventSchema {
+  static const int MAX_FIELDS = 3;
+
+  const char *name;
+  int numFields;
+  const char *fields[MAX_FIELDS];
+  char kinds[MAX_FIELDS];
+
+  static const EventSchema &of(int type);
+
+  // type of the event called name, 0 if none
+  static int named(const std::string &name);
+};
+
+/**
+ * header of event logs
+ */
+struct EventLogHeader {
+  char magic[8];
+  int version;
+  int numTeammates;
+  char teamName[16];
+
+  static const char *MAGIC;
+  static const int VERSION = 1;
+
+  void setup(int num_teammates, const std::string &team_name);
+
+  bool valid() const;
+};
+
+/**
+ * header of a block of events of one agent, followed by the deflated events;
+ * readers skip blocks by agent, cycle range and event types without
+ * inflating them
+ */
+struct EventBlockHeader {
+  uint32_t magic;
+  int agent; // uniform number
+  int firstCycle;
+  int lastCycle;
+  uint32_t types; // bit per event type in the block
+  uint32_t count;
+  uint32_t rawSize;
+  uint32_t size;
+
+  static const uint32_t MAGIC = 0x4b574542; // "KWEB"
+};
+
+/**
+ * value of a field: an integer (machine states are 64 bit hashes) or a float
+ */
+struct EventField {
+  int64_t i;
+  double x;
+
+  EventField() : i(0), x(0.0) {}
+  EventField(int v) : i(v), x(v) {}
+  EventField(unsigned v) : i(v), x(v) {}
+  EventField(long v) : i(v), x((double) v) {}
+  EventField(unsigned long v) : i((int64_t) v), x((double) v) {}
+  EventField(double v) : i(0), x(v) {}
+};
+
+struct EventRecord {
+  int agent;
+  int type;
+  int cycle;
+  EventField fields[EventSchema::MAX_FIELDS];
+  std::vector<double> list;
+};
+
+/**
+ * binary log of learner events: events are varint coded relative to the
+ * cycle of the previous event and appended in deflated blocks (one write per
+ * block, so that agents sharing the file do not interleave blocks)
+ */
+class EventLog {
+public:
+  static const size_t BLOCK_SIZE = 64 * 1024; // raw bytes
+
+  EventLog();
+
+  ~EventLog();
+
+  bool openWrite(const std::string &filename, const EventLogHeader &header);
+
+  bool openRead(const std::string &filename);
+
+  void close();
+
+  bool isOpen() const { return fd != -1 || in; }
+
+  const EventLogHeader &getHeader() const { return header; }
+
+  // events written from now on are of agent (a uniform number)
+  void setAgent(int agent_);
+
+  void write(int type, int cycle, EventField f0 = EventField(),
+             EventField f1 = EventField(), EventField f2 = EventField(),
+             const double *list = 0, int n = 0);
+
+  void flush();
+
+  // header of the next block, to read or skip
+  bool nextBlock(EventBlockHeader &block);
+
+  void skipBlock(const EventBlockHeader &block);
+
+  bool readBlock(const EventBlockHeader &block,
+                 std::vector<EventRecord> &records);
+
+private:
+  void putVarint(uint64_t v);
+
+  void putFloat(double v);
+
+  int fd; // writing
+  FILE *in; // reading
+  EventLogHeader header;
+  EventBlockHeader block;
+  int agent;
+  int cycle;
+  bool inEpisode;
+  std::vector<unsigned char> raw;
+  std::vector<unsigned char> deflated;
+};
+
+}
+
+#endif //KEEPAWAY_PLAYER_EVENTLOG_H
@@ -21,7 +21,7 @@ Memory::Memory() {
 }
 
 Memory &Memory::ins() {
-  static Memory memory;
+  static thread_local Memory memory;
   return memory;
 }
 
@@ -38,25 +38,25 @@ string Memory::to_string() {
   PRINT_VALUE_STREAM(ss, vector<ObjectT>(opponents, opponents + HierarchicalFSM::num_opponents));
   PRINT_VALUE_STREAM(
       ss, vector<double>(state, state + HierarchicalFSM::num_features));
-  PRINT_VALUE_STREAM(ss, stack);
+  PRINT_VALUE_STREAM(ss, MachineStateTable::ins().str(getStackId()));
 
   return ss.str();
 }
 
-const vector<string> &Memory::getStack() const { return stack; }
+stack_id_t Memory::getStackId() const {
+  return stack.empty() ? EMPTY_STACK : stack.back();
+}
 
-void Memory::PushStack(const string &s) {
-  stack.push_back(s);
-  if (Log.isInLogLevel(101)) {
-    Log.log(101, "Memory::PushStack: %s", to_prettystring(stack).c_str());
-  }
+void Memory::PushStack(frame_id_t f) {
+  stack.push_back(MachineStateTable::ins().push(getStackId(), f));
+  LOG(101, "Memory::PushStack: %s",
+      MachineStateTable::ins().str(getStackId()).c_str());
 }
 
 void Memory::PopStack() {
   stack.pop_back();
-  if (Log.isInLogLevel(101)) {
-    Log.log(101, "Memory::PopStack: %s", to_prettystring(stack).c_str());
-  }
+  LOG(101, "Memory::PopStack: %s",
+      MachineStateTable::ins().str(getStackId()).c_str());
 }
 
 size_t Memory::ballControlHash() {
@@ -68,7 +68,7 @@ int HierarchicalFSM::num_teammates;
 int HierarchicalFSM::num_opponents;
 
 HierarchicalFSM::HierarchicalFSM(BasicPlayer *p, const std::string &name)
-    : player(p), name(name) {
+    : player(p), name(name), frame(MachineStateTable::ins().frame(name)) {
   ACT = player->ACT;
   WM = player->WM;
   SS = player->SS;
@@ -80,7 +80,7 @@ HierarchicalFSM::HierarchicalFSM(BasicPlayer *p, const std::string &name)
 HierarchicalFSM::~HierarchicalFSM() { delete dummyChoice; }
 
 void HierarchicalFSM::action(bool sync) {
-  Log.log(101, "action with stack=%s", getStackStr().c_str());
+  LOG(101, "action with stack=%s", getStackStr().c_str());
 
   while (Memory::ins().bAlive) {
     if (sync)
@@ -88,8 +88,8 @@ void HierarchicalFSM::action(bool sync) {
 
     if (WM->getTimeLastSeeMessage() == WM->getCurrentTime() ||
         (SS->getSynchMode() && WM->getRecvThink())) {
-      Log.log(101, "send commands");
-      ACT->sendCommands();
+      LOG(101, "send commands");
+      ACT->sendCommands(TRACE_THINK_THREAD);
 
       if (SS->getSynchMode()) {
         WM->processRecvThink(false);
@@ -124,18 +124,18 @@ bool HierarchicalFSM::isFastestToBall() {
     minCycle = min(minCycle, iCycle);
     if (o == WM->getAgentObjectType())
       agentCycle = iCycle;
-    Log.log(101, "HierarchicalFSM::isFastestToBall ballFree teammate idx %d iCycle %d", i,
-            iCycle);
+    LOG(101, "HierarchicalFSM::isFastestToBall ballFree teammate idx %d iCycle %d", i,
+        iCycle);
   }
 
   if (agentCycle == minCycle && minCycle < INT_MAX) {
     bool fastest = minCycle < 100 || Memory::ins().agentIdx == 0;
-    Log.log(101, "HierarchicalFSM::isFastestToBall ballFree agentCycle %d = minCycle %d, fastest = %d",
-            agentCycle, minCycle, fastest);
+    LOG(101, "HierarchicalFSM::isFastestToBall ballFree agentCycle %d = minCycle %d, fastest = %d",
+        agentCycle, minCycle, fastest);
     return fastest;
   }
 
-  Log.log(101, "HierarchicalFSM::isFastestToBall false");
+  LOG(101, "HierarchicalFSM::isFastestToBall false");
   return false;
 }
 
@@ -180,10 +180,12 @@ void HierarchicalFSM::idle(const std::string error) {
     ACT->putCommandInQueue(soc = player->turnBodyToObject(OBJECT_BALL));
     ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
   }
-  Log.log(101, "idle (error: %s)", error.c_str());
+  LOG(101, "idle (error: %s)", error.c_str());
 }
 
 string HierarchicalFSM::getState() {
+  TraceSpan span(&WM->trace, TRACE_THINK_THREAD, TRACE_STATE,
+                 WM->getCurrentCycle());
   Memory::ins().resetState();
 
   if (WM->getConfidence(OBJECT_BALL) < PS->getBallConfThr()) {
@@ -236,15 +238,14 @@ string HierarchicalFSM::getState() {
 
 const string &HierarchicalFSM::getName() const { return name; }
 
+frame_id_t HierarchicalFSM::getFrame() const { return frame; }
+
 bool HierarchicalFSM::running() {
   return Memory::ins().bAlive && !WM->isNewEpisode();
 }
 
-string HierarchicalFSM::getStackStr() {
-  string str;
-  for (auto &s : Memory::ins().getStack())
-    str += s + " ";
-  return str;
+const string &HierarchicalFSM::getStackStr() {
+  return MachineStateTable::ins().str(Memory::ins().getStackId());
 }
 
 void HierarchicalFSM::initialize(int numFeatures, int numTeammates,
@@ -252,13 +253,15 @@ void HierarchicalFSM::initialize(int numFeatures, int numTeammates,
                                  double widths[], double gamma, double lambda, double alpha,
                                  double initialWeight, bool qLearning,
                                  string loadWeightsFile,
-                                 string saveWeightsFile, string teamName) {
+                                 string saveWeightsFile, string teamName,
+                                 int memorySize, Precision precision) {
   num_features = numFeatures;
   num_teammates = numTeammates;
   num_opponents = numOpponents;
   LinearSarsaLearner::ins().initialize(bLearn, widths, gamma, lambda, alpha,
                                        initialWeight, qLearning,
-                                       loadWeightsFile, saveWeightsFile, teamName);
+                                       loadWeightsFile, saveWeightsFile, teamName,
+                                       memorySize, precision);
 }
 
 Keeper::Keeper(BasicPlayer *p) : HierarchicalFSM(p, "{") {
@@ -295,7 +298,7 @@ void Keeper::run() {
       WM->setNewEpisode(false);
     }
 
-    Log.log(101, "Keeper::run agentIdx %d", Memory::ins().agentIdx);
+    LOG(101, "Keeper::run agentIdx %d", Memory::ins().agentIdx);
 #if KEEPER_LEARN
     if (WM->isBallKickable()) {
       MakeChoice<HierarchicalFSM *> choice(choices[1]);
@@ -319,7 +322,7 @@ void Keeper::run() {
 #endif
   }
 
-  Log.log(101, "Keeper::run exit");
+  LOG(101, "Keeper::run exit");
 }
 
 Taker::Taker(BasicPlayer *p) : HierarchicalFSM(p, "{") {
@@ -350,7 +353,7 @@ void Taker::run() {
       WM->setNewEpisode(false);
     }
 
-    Log.log(101, "Taker::run agentIdx %d", Memory::ins().agentIdx);
+    LOG(101, "Taker::run agentIdx %d", Memory::ins().agentIdx);
 
 #if TAKER_LEARN
     if (WM->isBallKickable()) {
@@ -373,7 +376,7 @@ void Taker::run() {
 #endif
   }
 
-  Log.log(101, "Taker::run exit");
+  LOG(101, "Taker::run exit");
 }
 
 Move::Move(BasicPlayer *p) : HierarchicalFSM(p, "$Move") {
@@ -402,9 +405,9 @@ void Move::run() {
     ACT->putCommandInQueue(
         soc = player->moveToPos(target, 25.0, 1.0, false, (int) cycles));
     ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
-    Log.log(101, "Move::run action with dir=%d, posPassFrom=%s, target=%s",
-            dir, to_prettystring(WM->getBallPos()).c_str(), to_prettystring(target).c_str());
-    Action(this, {to_prettystring(dir)})();
+    LOG(101, "Move::run action with dir=%d, posPassFrom=%s, target=%s",
+        dir, to_prettystring(WM->getBallPos()).c_str(), to_prettystring(target).c_str());
+    Action(this, {dir})();
     if (WM->isBallKickable()) break;
   }
 }
@@ -417,7 +420,7 @@ void Stay::run() {
     SoccerCommand soc;
     ACT->putCommandInQueue(soc = player->turnBodyToObject(OBJECT_BALL));
     ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
-    Log.log(101, "Stay::run action");
+    LOG(101, "Stay::run action");
     Action(this)();
     if (WM->isBallKickable()) break;
   }
@@ -430,7 +433,7 @@ void Intercept::run() {
     SoccerCommand soc;
     ACT->putCommandInQueue(soc = player->intercept(false));
     ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
-    Log.log(101, "Intercept::run action");
+    LOG(101, "Intercept::run action");
     Action(this)();
     if (WM->isTmControllBall()) break;
   }
@@ -463,9 +466,9 @@ void Pass::run() {
     VecPosition tmVel = WM->getGlobalVelocity(Memory::ins().teammates[teammate]);
     VecPosition target = WM->predictFinalAgentPos(&tmPos, &tmVel);
     ACT->putCommandInQueue(player->directPass(target, speed));
-    Log.log(101, "Pass::run action with teammate=%d speed=%s", teammate,
-            speed == PASS_NORMAL ? "normal" : "fast");
-    Action(this, {to_string(teammate), to_string(speed)})();
+    LOG(101, "Pass::run action with teammate=%d speed=%s", teammate,
+        speed == PASS_NORMAL ? "normal" : "fast");
+    Action(this, {teammate, speed})();
   }
 }
 
@@ -478,7 +481,7 @@ void Hold::run() {
   SoccerCommand soc;
   ACT->putCommandInQueue(soc = player->holdBall());
   ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
-  Log.log(101, "Hold::run action");
+  LOG(101, "Hold::run action");
   Action(this)();
 }
 
@@ -494,7 +497,7 @@ void GetOpen::run() {
     posPassFrom = refineTarget(posPassFrom, WM->getBallPos());
     ACT->putCommandInQueue(soc = player->getOpenForPassFromInRectangle(WM->getKeepawayRect(), posPassFrom));
     ACT->putCommandInQueue(player->turnNeckToObject(OBJECT_BALL, soc));
-    Log.log(101, "GetOpen::run action");
+    LOG(101, "GetOpen::run action");
     Action(this)();
     if (WM->isBallKickable()) break;
   }
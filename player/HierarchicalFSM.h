@@ -9,11 +9,14 @@
 #include <stack>
 #include <vector>
 #include "BasicPlayer.h"
+#include "MachineStateTable.h"
 #include "LinearSarsaLearner.h"
 #include <limits.h>
 
 namespace fsm {
 class HierarchicalFSM;
+
+enum Precision : int;
 }
 
 namespace std {
@@ -49,12 +52,12 @@ public:
   ObjectT opponents[11]; // current mapping from index to opponents
 
 private:
-  std::vector<string> stack;  // self call stack
+  std::vector<stack_id_t> stack;  // self call stack (configuration after each push)
 
 public:
-  const vector<string> &getStack() const;
+  stack_id_t getStackId() const;
 
-  void PushStack(const string &s);
+  void PushStack(frame_id_t f);
 
   void PopStack();
 
@@ -101,15 +104,18 @@ protected:
 
   bool running();
 
-  static std::string getStackStr();
+  static const std::string &getStackStr();
 
 protected:
   BasicPlayer *player;
   const std::string name;
+  const frame_id_t frame;
 
 public:
   const std::string &getName() const;
 
+  frame_id_t getFrame() const;
+
   static void initialize(int numFeatures,
                          int numTeammates,
                          int numOpponents,
@@ -122,7 +128,9 @@ public:
                          bool qLearning,
                          string loadWeightsFile,
                          string saveWeightsFile,
-                         string teamName);
+                         string teamName,
+                         int memorySize,
+                         Precision precision);
 
 protected:
   ActHandler *ACT; /*!< ActHandler to which commands can be sent        */
@@ -69,6 +69,7 @@ void KeepawayPlayer::mainLoop( )
 {
   Log.setHeader(-1);
   bool bContLoop = true;
+  fsm::CycleTrace::setCurrent(&WM->trace); // traced by the learner
 
   // do initialization stuff
   if (!WM->waitForNewInformation()) bContLoop = false;
@@ -91,6 +92,7 @@ void KeepawayPlayer::mainLoop( )
          ((double)WM->iNrTeammatesSeen/WM->getCurrentCycle()));
   printf("   Opponents seen: %d (%f)\n", WM->iNrOpponentsSeen,
          ((double)WM->iNrOpponentsSeen/WM->getCurrentCycle()));
+  if (fsm::CycleTrace::enabled) WM->trace.report(stdout);
 }
 
 
@@ -194,7 +196,7 @@ SoccerCommand KeepawayPlayer::idle(string error)
   SoccerCommand soc;
   ACT->putCommandInQueue( soc = turnBodyToObject( OBJECT_BALL ) );
   ACT->putCommandInQueue( turnNeckToObject( OBJECT_BALL, soc ) );
-  Log.log(101, "idle (error: %s)", error.c_str());
+  LOG(101, "idle (error: %s)", error.c_str());
   return soc;
 }
 
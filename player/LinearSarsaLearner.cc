@@ -3,65 +3,473 @@
 //
 
 #include "LinearSarsaLearner.h"
+#include "Checkpointer.h"
 #include "gzstream.h"
 #include <boost/algorithm/string/replace.hpp>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <signal.h>
+#include <sstream>
 
 #define DETERMINISTIC_GRAPH 0
 
 namespace fsm {
 
-void SharedData::reset() {
-  lastJointChoiceIdx = -1;
-  lastJointChoiceTime = UnknownTime;
-  memset(lastJointChoice, 0, sizeof(lastJointChoice));
+const char *WeightsHeader::MAGIC = "KWQ-WGT";
+
+void WeightsHeader::setup(int memory_size, Precision prec) {
+  memset(this, 0, sizeof(WeightsHeader));
+  memcpy(magic, MAGIC, sizeof(magic));
+  version = VERSION;
+  memorySize = memory_size;
+  precision = prec;
+}
+
+bool WeightsHeader::valid() const {
+  return strncmp(magic, MAGIC, sizeof(magic)) == 0 &&
+         version > 0 && version <= VERSION && memorySize > 0 &&
+         (precision == PRECISION_FLOAT || precision == PRECISION_DOUBLE);
+}
+
+/**
+ * restore the collision table of a mapped weight file
+ * @param file mapping of the file
+ * @param ct
+ */
+void MappedWeightsHeader::restoreColTab(const char *file,
+                                        collision_table &ct) const {
+  ct.restore(file + colTabOffset, version < 3, version < 5, colTabSafe,
+             colTabCalls, colTabClearhits, colTabCollisions);
+  ct.probing = version >= 3 ? colTabProbing : collision_table::PROBING_DOUBLE;
+}
+
+const char *MappedWeightsHeader::MAGIC = "KWQ-MAP";
+
+void MappedWeightsHeader::setup(int memory_size, Precision prec,
+                                int num_features, int tilings_per_group,
+                                const double widths[],
+                                const collision_table &ct) {
+  memset(this, 0, sizeof(MappedWeightsHeader));
+  memcpy(magic, MAGIC, sizeof(magic));
+  version = VERSION;
+  memorySize = memory_size;
+  precision = prec;
+  numFeatures = num_features;
+  tilingsPerGroup = tilings_per_group;
+  for (int i = 0; i < num_features; ++i) {
+    tileWidths[i] = widths[i];
+  }
+  colTabSize = ct.size;
+  colTabSafe = ct.safe;
+  colTabProbing = ct.probing;
+  colTabCalls = ct.calls;
+  colTabClearhits = ct.clearhits;
+  colTabCollisions = ct.collisions;
+  scale = 1.0;
+  offset = 0.0;
+
+  auto align = [](long n) { return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1); };
+  weightsOffset = align(sizeof(MappedWeightsHeader));
+  colTabOffset = weightsOffset + align((long) memory_size * prec);
+  fileSize = colTabOffset + align((long) colTabSize * sizeof(int));
+}
+
+bool MappedWeightsHeader::valid() const {
+  return strncmp(magic, MAGIC, sizeof(magic)) == 0 &&
+         version > 0 && version <= VERSION && memorySize > 0 &&
+         (precision == PRECISION_FLOAT || precision == PRECISION_DOUBLE ||
+          (precision == PRECISION_INT16 && version >= 2 && scale > 0.0)) &&
+         colTabSize == memorySize &&
+         numFeatures >= 0 && numFeatures <= MAX_RL_STATE_VARS &&
+         weightsOffset % ALIGNMENT == 0 && colTabOffset % ALIGNMENT == 0 &&
+         weightsOffset + (long) memorySize * precision <= colTabOffset &&
+         colTabOffset + (long) colTabSize * colTabEntrySize() <= fileSize;
+}
+
+static const int tilingsPerGroup = 32;
+
+static long alignCacheLine(long n) { return (n + 63) & ~63L; }
+
+long SharedData::size(int memory_size, Precision prec, bool mapped_weights,
+                      bool pooled) {
+  long n = alignCacheLine(sizeof(SharedData));
+  if (!mapped_weights && !pooled)
+    n += alignCacheLine((long) memory_size * prec); // weights
+  n += alignCacheLine((long) memory_size * prec); // traces
+  n += alignCacheLine((long) memory_size * sizeof(int)); // nonzeroTracesInverse
+  if (!pooled) {
+    n += alignCacheLine((long) memory_size * sizeof(int)); // colTab
+    n += alignCacheLine(collision_table::pages(memory_size)); // dirty pages
+  }
+  return n;
+}
+
+void SharedData::layout(int memory_size, Precision prec, bool mapped_weights,
+                        bool pooled) {
+  memorySize = memory_size;
+  precision = prec;
+  weightsOffset = -1;
+  tracesOffset = alignCacheLine(sizeof(SharedData));
+  if (!mapped_weights && !pooled) {
+    weightsOffset = tracesOffset;
+    tracesOffset += alignCacheLine((long) memory_size * prec);
+  }
+  nonzeroTracesInverseOffset =
+      tracesOffset + alignCacheLine((long) memory_size * prec);
+  colTabOffset = -1;
+  dirtyOffset = -1;
+  if (pooled) return;
+
+  colTabOffset = nonzeroTracesInverseOffset +
+                 alignCacheLine((long) memory_size * sizeof(int));
+  dirtyOffset = colTabOffset + alignCacheLine((long) memory_size * sizeof(int));
+  colTab.attach((int *) at(colTabOffset), memory_size);
+  colTab.attachDirty((unsigned char *) at(dirtyOffset));
+}
+
+long WeightPool::size(int memory_size, Precision prec) {
+  long n = alignCacheLine(sizeof(WeightPool));
+  n += alignCacheLine((long) memory_size * prec); // weights
+  n += alignCacheLine((long) memory_size * sizeof(int)); // colTab
+  return n;
+}
+
+/**
+ * the collision table of a pool has no dirty pages, so that checkpoints of
+ * pooled learners are full snapshots
+ */
+void WeightPool::layout(int memory_size, Precision prec, int generation_) {
+  memorySize = memory_size;
+  precision = prec;
+  generation = generation_;
+  creator = getpid();
+  attached = 0;
+  memset(&learners, 0, sizeof(learners));
+  weightsOffset = alignCacheLine(sizeof(WeightPool));
+  colTabOffset = weightsOffset + alignCacheLine((long) memory_size * prec);
+  colTab.attach((int *) at(colTabOffset), memory_size);
+  colTab.attachDirty(0);
+  colTab.concurrent = 1;
+}
+
+void ProcessSet::add(int pid) {
+  for (auto &p : pids) {
+    if (!p) {
+      p = pid;
+      return;
+    }
+  }
+}
+
+void ProcessSet::remove(int pid) {
+  for (auto &p : pids) {
+    if (p == pid) {
+      p = 0;
+      return;
+    }
+  }
+}
+
+int ProcessSet::alive() const {
+  int n = 0;
+  for (auto p : pids) {
+    if (p && (kill(p, 0) == 0 || errno == EPERM)) n += 1;
+  }
+  return n;
+}
+
+void SharedData::reset(bool zeroed) {
+  JointDecision d;
+  memset(&d, 0, sizeof(d));
+  d.idx = -1;
+  d.time = UnknownTime;
+  publish(d);
 
   memset(Q, 0, sizeof(Q));
-  memset(traces, 0, sizeof(traces));
+  if (!zeroed) { // a fresh segment is zero filled, and untouched
+    memset(at(tracesOffset), 0, (size_t) memorySize * precision);
+    memset(at(nonzeroTracesInverseOffset), 0, memorySize * sizeof(int));
+  }
   memset(nonzeroTraces, 0, sizeof(nonzeroTraces));
-  memset(nonzeroTracesInverse, 0, sizeof(nonzeroTracesInverse));
 
   minimumTrace = 0.01;
+  traceScale = 1.0;
   numNonzeroTraces = 0;
 
   memset(numChoices, 0, sizeof(numChoices));
   memset(machineState, 0, sizeof(machineState));
-  memset(lastMachineState, 0, sizeof(lastMachineState));
-}
-
-choice_t SharedData::getLastJointChoice() const {
-  return choice_t(lastJointChoice,
-                  lastJointChoice + HierarchicalFSM::num_teammates);
+  memset(choicePoints, 0, sizeof(choicePoints));
 }
 
-num_choice_t SharedData::getNumChoices() const {
-  num_choice_t ret((unsigned long) HierarchicalFSM::num_teammates);
+void SharedData::getNumChoices(num_choice_t &ret) const {
+  ret.resize((unsigned long) HierarchicalFSM::num_teammates);
   for (int i = 0; i < HierarchicalFSM::num_teammates; ++i) {
     ret[i] = numChoices[Memory::ins().teammates[i]];
   }
-  return ret;
 }
 
-machine_state_t SharedData::getMachineState() const {
-  machine_state_t ret((unsigned long) HierarchicalFSM::num_teammates);
+void SharedData::getMachineState(machine_state_t &ret) const {
+  ret.resize((unsigned long) HierarchicalFSM::num_teammates);
   for (int i = 0; i < HierarchicalFSM::num_teammates; ++i) {
     ret[i] = machineState[Memory::ins().teammates[i]];
   }
-  return ret;
 }
 
-machine_state_t SharedData::getLastMachineState() const {
-  machine_state_t ret((unsigned long) HierarchicalFSM::num_teammates);
-  for (int i = 0; i < HierarchicalFSM::num_teammates; ++i) {
-    ret[i] = lastMachineState[i];
+/**
+ * publish a joint decision (by its only writer, agent 0)
+ * @param d
+ */
+void SharedData::publish(const JointDecision &d) {
+  unsigned seq = __atomic_load_n(&decisionSeq, __ATOMIC_RELAXED);
+  __atomic_store_n(&decisionSeq, seq + 1, __ATOMIC_RELAXED); // odd: writing
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(&decision, &d, sizeof(JointDecision));
+  __atomic_store_n(&decisionSeq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * a consistent copy of the joint decision published last, without waiting
+ * for the writer: copies overlapping a write are retried, and the read is
+ * counted once as torn
+ * @param ret
+ */
+void SharedData::readDecision(JointDecision &ret) {
+  __atomic_add_fetch(&decisionReads, 1, __ATOMIC_RELAXED);
+  bool torn = false;
+  for (;;) {
+    unsigned seq = __atomic_load_n(&decisionSeq, __ATOMIC_ACQUIRE);
+    if (!(seq & 1)) {
+      memcpy(&ret, &decision, sizeof(JointDecision));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&decisionSeq, __ATOMIC_RELAXED) == seq) break;
+    } else {
+      sched_yield(); // let the writer (maybe on this cpu) finish
+    }
+    torn = true;
   }
-  return ret;
+  if (torn) __atomic_add_fetch(&tornReads, 1, __ATOMIC_RELAXED);
 }
 
+/**
+ * publish the choice point of an agent (by that agent only)
+ * @param object type of the agent
+ * @param time
+ * @param num_choices
+ * @param machine_state
+ */
+void SharedData::publishChoicePoint(int object, int time, int num_choices,
+                                    stack_id_t machine_state) {
+  PublishedChoicePoint &c = choicePoints[object];
+  unsigned seq = __atomic_load_n(&c.seq, __ATOMIC_RELAXED);
+  __atomic_store_n(&c.seq, seq + 1, __ATOMIC_RELAXED); // odd: writing
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&c.time, time, __ATOMIC_RELAXED);
+  __atomic_store_n(&c.numChoices, num_choices, __ATOMIC_RELAXED);
+  __atomic_store_n(&c.machineState, machine_state, __ATOMIC_RELAXED);
+  __atomic_store_n(&c.seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * a consistent copy of the choice point an agent published last; a copy
+ * overlapping the write (a few stores) is retried
+ * @param object type of the agent
+ * @param ret
+ */
+void SharedData::readChoicePoint(int object, PublishedChoicePoint &ret) {
+  PublishedChoicePoint &c = choicePoints[object];
+  for (;;) {
+    unsigned seq = __atomic_load_n(&c.seq, __ATOMIC_ACQUIRE);
+    ret.time = __atomic_load_n(&c.time, __ATOMIC_RELAXED);
+    ret.numChoices = __atomic_load_n(&c.numChoices, __ATOMIC_RELAXED);
+    ret.machineState = __atomic_load_n(&c.machineState, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!(seq & 1) && __atomic_load_n(&c.seq, __ATOMIC_RELAXED) == seq) {
+      ret.seq = seq;
+      return;
+    }
+    sched_yield(); // let the writer (maybe on this cpu) finish
+  }
+}
+
+JointChoices::JointChoices(const num_choice_t &num_choices) {
+  numAgents = (int) num_choices.size();
+  Assert(numAgents <= 11);
+  count = 1;
+  for (int i = numAgents - 1; i >= 0; --i) {
+    Assert(num_choices[i] > 0);
+    radix[i] = num_choices[i];
+    stride[i] = count;
+    count *= radix[i];
+  }
+  Assert(count <= MAX_RL_ACTIONS);
+}
+
+void JointChoices::decode(int c, choice_t &ret) const {
+  ret.resize((size_t) numAgents);
+  for (int i = 0; i < numAgents; ++i) {
+    ret[i] = choice(c, i);
+  }
+}
+
+const int *JointChoices::ids() {
+  static const vector<int> ids = [] {
+    vector<int> v(MAX_RL_ACTIONS);
+    for (int i = 0; i < MAX_RL_ACTIONS; ++i) v[i] = i;
+    return v;
+  }();
+  return ids.data();
+}
+
+/**
+ * one learner per agent (thread); agents of the same team share SharedData
+ */
 LinearSarsaLearner &LinearSarsaLearner::ins() {
-  static LinearSarsaLearner learner;
+  static thread_local LinearSarsaLearner learner;
   return learner;
 }
 
+bool LinearSarsaLearner::inProcess = false;
+
+static std::mutex inProcessMutex; // guards inProcessData and its setup
+static unordered_map<string, SharedData *> inProcessData;
+
+/**
+ * agents run as threads of this process: share SharedData in process memory
+ * (instead of shm) -- to be called before any agent is initialized
+ * @param threads
+ */
+void LinearSarsaLearner::setInProcess(bool threads) { inProcess = threads; }
+
+string LinearSarsaLearner::weightPool;
+
+/**
+ * learn into the weight pool of that name, shared with the learners of other
+ * games with the same team, memory size, precision and initial weight running
+ * concurrently (see WeightPool) -- to be called before any agent is
+ * initialized; ignored when not learning
+ * @param name
+ */
+void LinearSarsaLearner::setWeightPool(const string &name) { weightPool = name; }
+
+unsigned LinearSarsaLearner::rngSeed = 0;
+
+/**
+ * seed of exploration and tie breaking (0: time) -- to be called before any
+ * agent is initialized
+ * @param seed
+ */
+void LinearSarsaLearner::setSeed(unsigned seed) { rngSeed = seed; }
+
+bool LinearSarsaLearner::hugePages = false;
+const char *LinearSarsaLearner::pagesAdvice = "none";
+
+/**
+ * back shared data (and weight pools) by 2 MB huge pages, to spare TLB misses
+ * of random weight and trace accesses: reserved huge pages (MAP_HUGETLB) in
+ * process if there are enough of them, transparent huge pages (if enabled for
+ * anonymous or shm memory, see /sys/kernel/mm/transparent_hugepage)
+ * otherwise -- to be called before any agent is initialized
+ * @param huge
+ */
+void LinearSarsaLearner::setHugePages(bool huge) { hugePages = huge; }
+
+/**
+ * ask for transparent huge pages backing a mapping (if huge pages are set)
+ * @param p
+ * @param bytes
+ */
+void LinearSarsaLearner::adviseHugePages(void *p, size_t bytes) {
+  if (!hugePages) return;
+  pagesAdvice = madvise(p, bytes, MADV_HUGEPAGE) == 0 ? "MADV_HUGEPAGE"
+                                                      : "none (madvise failed)";
+}
+
+/**
+ * page size and resident bytes of the mapping holding p (from
+ * /proc/self/smaps), and how many of them are on transparent huge pages
+ * @param p
+ * @param pageSize
+ * @param resident
+ * @param huge
+ * @return false if the mapping is not found
+ */
+bool LinearSarsaLearner::pageStats(const void *p, long &pageSize,
+                                   long &resident, long &huge) {
+  ifstream is("/proc/self/smaps");
+  unsigned long addr = (unsigned long) p;
+  bool found = false;
+  pageSize = resident = huge = 0;
+  string line;
+  while (getline(is, line)) {
+    unsigned long first, last;
+    char dash;
+    if (isxdigit(line[0])) { // start of a mapping
+      if (found) break;
+      istringstream ls(line);
+      ls >> hex >> first >> dash >> last;
+      found = first <= addr && addr < last;
+    } else if (found) {
+      istringstream ls(line);
+      string key;
+      long kb = 0;
+      ls >> key >> kb;
+      if (key == "KernelPageSize:") pageSize = kb << 10;
+      else if (key == "Rss:") resident = kb << 10;
+      else if (key == "AnonHugePages:" || key == "ShmemPmdMapped:")
+        huge += kb << 10;
+    }
+  }
+  return found;
+}
+
+/**
+ * print the page size achieved for a mapping
+ * @param what
+ * @param p
+ */
+void LinearSarsaLearner::reportPages(const char *what, const void *p) {
+  long pageSize, resident, huge;
+  if (!pageStats(p, pageSize, resident, huge)) return;
+  cerr << what << ": page size " << (pageSize >> 10) << " kB, "
+       << (huge >> 10) << " of " << (resident >> 10)
+       << " kB resident on transparent huge pages (huge pages: "
+       << pagesAdvice << ")" << endl;
+}
+
+/**
+ * get SharedData of this process by name (inProcessMutex held)
+ * @param name
+ * @param bytes
+ * @param created set if not shared before
+ * @return
+ */
+SharedData *LinearSarsaLearner::attachInProcess(const string &name,
+                                                size_t bytes, bool &created) {
+  auto it = inProcessData.find(name);
+  created = it == inProcessData.end();
+  if (!created) return it->second;
+
+  // reserved huge pages are not overcommitted: the map fails (instead of a
+  // later page fault) if there are not enough of them
+  void *data = MAP_FAILED;
+  if (hugePages) {
+    data = mmap(0, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) pagesAdvice = "MAP_HUGETLB";
+  }
+  if (data == MAP_FAILED) {
+    data = mmap(0, bytes, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (data == MAP_FAILED) {
+      printf("prod: Map failed: %s\n", strerror(errno));
+      exit(1);
+    }
+    adviseHugePages(data, bytes);
+  }
+  return inProcessData[name] = (SharedData *) data;
+}
+
 LinearSarsaLearner::~LinearSarsaLearner() { shutDown(); }
 
 LinearSarsaLearner::LinearSarsaLearner() {
@@ -72,16 +480,35 @@ LinearSarsaLearner::LinearSarsaLearner() {
   epsilon = 0.01;
   bLearning = false;
   qLearning = false;
+  memorySize = RL_MEMORY_SIZE;
+  precision = PRECISION_DOUBLE;
   sharedData = 0;
+  pool = 0;
+  colTab = 0;
+  mappedWeights = 0;
   lastJointChoiceIdx = -1;
   lastJointChoiceTime = UnknownTime;
+  jointMachineState = -1;
+  barrierTimeout = 1000;
+  checkpointEpisodes = 0;
+  checkpointSeconds = 0;
+  checkpointKeep = 3;
+  checkpointDeltas = CHECKPOINT_DELTAS;
+  checkpointer = 0;
+  replayChoice = -1;
+  decentralized = false;
+  tieSeed = 0;
 }
 
 void LinearSarsaLearner::initialize(bool learning, double width[], double Gamma,
                                     double Lambda, double Alpha, double weight,
                                     bool QLearning,
                                     string loadWeightsFile,
-                                    string saveWeightsFile_, string teamName_) {
+                                    string saveWeightsFile_, string teamName_,
+                                    int memorySize_, Precision precision_) {
+  unique_lock<mutex> lock(inProcessMutex, defer_lock);
+  if (inProcess) lock.lock();
+
   bLearning = learning;
   bSaveWeights = bLearning && saveWeightsFile_.length() > 0;
   saveWeightsFile = saveWeightsFile_;
@@ -101,19 +528,66 @@ void LinearSarsaLearner::initialize(bool learning, double width[], double Gamma,
   lastJointChoiceIdx = -1;
   lastJointChoiceTime = UnknownTime;
 
-  srand((unsigned int) 0);
-  srand48((unsigned int) 0);
-  int tmp[2];
-  float tmpf[2];
-
-  GetTiles(tmp, 1, 1, tmpf, 0); // A dummy call to set the hashing table
-  srand((unsigned int) time(NULL));
-  srand48((unsigned int) time(NULL));
+  // the C library generators (used by the rest of the player) are seeded
+  // along with rng, so that runs with a seed repeat
+  unsigned seed = rngSeed ? rngSeed : (unsigned int) time(NULL);
+  rng.seed(seed);
+  srand(seed);
+  srand48(seed);
 
   numTilings = 0;
   minimumTrace = 0.01;
+  traceScale = 1.0;
   numNonzeroTraces = 0;
 
+  // rows for as many choices as the first decisions need
+  tiles_.reserve(HierarchicalFSM::num_features * tilingsPerGroup, 1);
+  valueTiles.reserve(HierarchicalFSM::num_features * tilingsPerGroup, 1);
+
+  string weightsFile = loadWeightsFile;
+  vector<string> checkpoints; // full checkpoint, then deltas
+  if (bSaveWeights) { // resume from the latest checkpoint (if newer)
+    checkpoints = Checkpointer::latest(saveWeightsFile);
+    if (!checkpoints.empty()) {
+      cerr << "Resuming from checkpoint " << checkpoints.back() << endl;
+      weightsFile = checkpoints[0];
+    }
+  }
+
+  memorySize = memorySize_;
+  precision = precision_;
+  WeightsHeader header;
+  MappedWeightsHeader mappedHeader;
+  bool mapped = false; // weights mapped read only from the weight file
+  if (!weightsFile.empty() &&
+      peekMappedWeights(weightsFile.c_str(), mappedHeader)) {
+    header.setup(mappedHeader.memorySize, (Precision) mappedHeader.precision);
+    mapped = !bLearning;
+    if (mapped && mappedHeader.precision != PRECISION_INT16)
+      precision = (Precision) mappedHeader.precision; // of traces otherwise
+  } else if (weightsFile.empty() ||
+             !peekWeights(weightsFile.c_str(), header)) {
+    header.setup(memorySize, precision);
+  }
+
+  if (header.memorySize != memorySize) {
+    cerr << "Using memory size " << header.memorySize << " of weight file "
+         << weightsFile << " instead of " << memorySize << endl;
+    memorySize = header.memorySize;
+  }
+
+  if (memorySize < 2 || (memorySize & (memorySize - 1)) != 0) {
+    printf("Memory size must be a power of 2: %d\n", memorySize);
+    exit(1);
+  }
+
+  bool pooled = !weightPool.empty() && !mapped; // weights in a WeightPool
+  if (pooled && !bLearning) {
+    cerr << "Weight pool " << weightPool << " is ignored when not learning"
+         << endl;
+    pooled = false;
+  }
+
   if (bLearning || !bLearning) {
     string exepath = getexepath();
     exepath += "LinearSarsaLearner::initialize";
@@ -124,73 +598,386 @@ void LinearSarsaLearner::initialize(bool learning, double width[], double Gamma,
     exepath += to_string(initialWeight);
     exepath += to_string(qLearning);
     exepath += teamName;
+    exepath += to_string(memorySize);
+    exepath += to_string(precision);
+    exepath += to_string(mapped);
+    exepath += pooled ? weightPool : "";
     auto h = hash<string>()(exepath); // hashing
     sharedMemory = "/" + to_string(h) + ".shm";
 
-    int shm_fd = shm_open(sharedMemory.c_str(), O_CREAT | O_RDWR, 0666);
-    if (shm_fd == -1) {
-      printf("prod: Shared memory failed: %s\n", strerror(errno));
-      exit(1);
-    }
+    auto bytes = SharedData::size(memorySize, precision, mapped, pooled);
+    bool created; // set up by this process (first to attach)
+    bool fresh; // zero filled: pages are only backed once touched
+    unique_ptr<FileLock> setupLock; // of processes, held until set up
+    if (inProcess) {
+      sharedData = attachInProcess(sharedMemory, bytes, created);
+      fresh = created;
+      if (created) {
+        for (auto &barrier : sharedData->barriers) barrier.reset();
+      }
+    } else {
+      // the first process to attach sets up shared data (the segment may be
+      // left by a run that died, e.g. at a barrier) before any other uses it
+      setupLock.reset(new FileLock(sharedMemory.substr(1)));
+      int shm_fd = shm_open(sharedMemory.c_str(), O_CREAT | O_RDWR, 0666);
+      if (shm_fd == -1) {
+        printf("prod: Shared memory failed: %s\n", strerror(errno));
+        exit(1);
+      }
 
-    ftruncate(shm_fd, sizeof(SharedData));
-    sharedData = (SharedData *) mmap(
-        0, sizeof(SharedData), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
-    if (sharedData == MAP_FAILED) {
-      printf("prod: Map failed: %s\n", strerror(errno));
-      exit(1);
+      struct stat st;
+      if (fstat(shm_fd, &st) == -1 || ftruncate(shm_fd, bytes) == -1) {
+        printf("prod: Shared memory failed: %s\n", strerror(errno));
+        exit(1);
+      }
+      fresh = st.st_size == 0;
+      sharedData = (SharedData *) mmap(
+          0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE,
+          shm_fd, 0);
+      close(shm_fd);
+      if (sharedData == MAP_FAILED) {
+        printf("prod: Map failed: %s\n", strerror(errno));
+        exit(1);
+      }
+      adviseHugePages(sharedData, bytes);
+
+      created = fresh || !sharedData->processes.alive();
+      if (created) {
+        for (auto &barrier : sharedData->barriers) barrier.reset();
+        memset(&sharedData->processes, 0, sizeof(ProcessSet));
+      }
+      sharedData->processes.add(getpid());
     }
 
+    if (created) sharedData->layout(memorySize, precision, mapped, pooled);
     Q = sharedData->Q;
-    tiles_ = sharedData->tiles;
-    weights = sharedData->weights;
-    traces = sharedData->traces;
+    if (pooled) {
+      attachWeightPool(weightsFile, checkpoints);
+    } else if (mapped) {
+      mappedWeights = mapWeights(weightsFile.c_str(), mappedHeader);
+      if (!mappedWeights) exit(1);
+      weights.attach((void *) (mappedWeights + mappedHeader.weightsOffset),
+                     (Precision) mappedHeader.precision, mappedHeader.scale,
+                     mappedHeader.offset);
+    } else { // stored relative to the initial weight, so that zero pages
+             // hold initial weights
+      weights.attach(sharedData->at(sharedData->weightsOffset), precision,
+                     1.0, initialWeight);
+    }
+    traces.attach(sharedData->at(sharedData->tracesOffset), precision);
     nonzeroTraces = sharedData->nonzeroTraces;
-    nonzeroTracesInverse = sharedData->nonzeroTracesInverse;
-    colTab = &sharedData->colTab;
-
-    barriers["enter1"] = new Barrier(HierarchicalFSM::num_teammates, h, "enter1");
-    barriers["exit1"] = new Barrier(HierarchicalFSM::num_teammates, h, "exit1");
-    barriers["enter2"] = new Barrier(HierarchicalFSM::num_teammates, h, "enter2");
-    barriers["exit2"] = new Barrier(HierarchicalFSM::num_teammates, h, "exit2");
-    barriers["reset"] = new Barrier(HierarchicalFSM::num_teammates, h, "reset");
-
-    sharedData->reset();
-    if (loadWeightsFile.empty() || !loadWeights(loadWeightsFile.c_str())) {
-      fill(weights, weights + RL_MEMORY_SIZE, initialWeight);
-      colTab->reset();
+    nonzeroTracesInverse =
+        (int *) sharedData->at(sharedData->nonzeroTracesInverseOffset);
+    if (!pooled) colTab = &sharedData->colTab;
+    MachineStateTable::ins().attach(&sharedData->stackDict);
+
+    if (created) {
+      sharedData->reset(fresh);
+      // weights are loaded over zero filled (initial) weights
+      if (!fresh && !mapped && !pooled) weights.fill(memorySize, initialWeight);
+      if (pooled) { // weights are set up by the pool
+      } else if (weightsFile.empty() || !loadWeights(weightsFile.c_str())) {
+        if (!weightsFile.empty() && !mapped) { // after a partial read
+          weights.fill(memorySize, initialWeight);
+        }
+        colTab->reset(fresh && weightsFile.empty());
+      } else {
+        for (uint i = 1; i < checkpoints.size(); ++i) {
+          Checkpointer::applyDelta(checkpoints[i], weights, memorySize, colTab);
+        }
+      }
+      if (hugePages) reportPages("Shared data", sharedData);
     }
   }
 }
 
 void LinearSarsaLearner::shutDown() {
+  delete checkpointer; // after writing the pending checkpoint
+  checkpointer = 0;
+  events.close();
+
   if (Memory::ins().agentIdx == 0) {
+    if (bLearning && colTab) {
+      cerr << "Collision table: load factor " << colTab->loadFactor()
+           << ", average probe length " << colTab->probeLength()
+           << ", overflows " << colTab->overflows << endl;
+    }
     if (bLearning && bSaveWeights) {
       cerr << "Saving weights at shutdown." << endl;
       saveWeights(saveWeightsFile.c_str());
     }
   }
 
-  if (sharedData)
-    shm_unlink(sharedMemory.c_str());
-  for (auto pa : barriers)
-    delete pa.second;
+  if (sharedData) {
+    for (int b = 0; b < BARRIER_COUNT; ++b) {
+      if (sharedData->barriers[b].timeouts) {
+        cerr << "Barrier " << b << " timeouts: "
+             << sharedData->barriers[b].timeouts << " out of "
+             << sharedData->barriers[b].waits << " waits" << endl;
+      }
+    }
+    if (sharedData->tornReads || sharedData->staleDecisions) {
+      cerr << "Joint decision reads: " << sharedData->tornReads
+           << " torn (retried), " << sharedData->staleDecisions
+           << " stale out of " << sharedData->decisionReads << endl;
+    }
+    if (sharedData->staleChoicePoints) {
+      cerr << "Decentralized decisions: " << sharedData->staleChoicePoints
+           << " on stale choice points of teammates out of "
+           << sharedData->decisions << endl;
+    }
+    if (!inProcess) {
+      FileLock lock(sharedMemory.substr(1));
+      sharedData->processes.remove(getpid());
+      shm_unlink(sharedMemory.c_str());
+    }
+  }
+
+  detachWeightPool();
+
+  if (mappedWeights) {
+    MappedWeightsHeader *header = (MappedWeightsHeader *) mappedWeights;
+    munmap((void *) mappedWeights, (size_t) header->fileSize);
+    mappedWeights = 0;
+  }
+}
+
+/**
+ * join the weight pool (creating it if this is the first learner to join,
+ * with weights loaded from weightsFile and checkpoints as usual); the pool
+ * lock serializes setup and the count of attached learners
+ * a pool left by learners that all died (e.g. crashed without detaching) is
+ * stale, and is set up again instead of joined
+ * @param weightsFile
+ * @param checkpoints
+ */
+void LinearSarsaLearner::attachWeightPool(const string &weightsFile,
+                                          const vector<string> &checkpoints) {
+  string name = "LinearSarsaLearner::attachWeightPool";
+  name += weightPool;
+  name += teamName;
+  name += to_string(memorySize);
+  name += to_string(precision);
+  name += to_string(initialWeight);
+  auto h = hash<string>()(name);
+  poolMemory = "/" + to_string(h) + ".pool.shm";
+  poolLock = "pool-" + to_string(h);
+
+  FileLock lock(poolLock);
+  int shm_fd = shm_open(poolMemory.c_str(), O_CREAT | O_RDWR, 0666);
+  if (shm_fd == -1) {
+    printf("prod: Shared memory failed: %s\n", strerror(errno));
+    exit(1);
+  }
+
+  struct stat st;
+  if (fstat(shm_fd, &st) == -1) {
+    printf("prod: Shared memory failed: %s\n", strerror(errno));
+    exit(1);
+  }
+  auto bytes = WeightPool::size(memorySize, precision);
+  bool created = st.st_size == 0;
+  int generation = 1;
+  if (!created) {
+    pool = (WeightPool *) mmap(0, sizeof(WeightPool), PROT_READ, MAP_SHARED,
+                               shm_fd, 0);
+    if (pool == MAP_FAILED) {
+      printf("prod: Map failed: %s\n", strerror(errno));
+      exit(1);
+    }
+    if (!pool->learners.alive()) {
+      cerr << "Weight pool " << weightPool << " (generation "
+           << pool->generation << ", created by " << pool->creator
+           << ") has no live learners, setting it up again" << endl;
+      generation = pool->generation + 1;
+      created = true;
+    } else if (st.st_size != bytes) {
+      cerr << "Weight pool " << weightPool << " has size " << st.st_size
+           << " instead of " << bytes << endl;
+      exit(1);
+    }
+    munmap(pool, sizeof(WeightPool));
+    // truncated to zero first, so that a stale pool is zero filled again
+    if (created && ftruncate(shm_fd, 0) == -1) {
+      printf("prod: Shared memory failed: %s\n", strerror(errno));
+      exit(1);
+    }
+  }
+  if (created && ftruncate(shm_fd, bytes) == -1) {
+    printf("prod: Shared memory failed: %s\n", strerror(errno));
+    exit(1);
+  }
+  pool = (WeightPool *) mmap(
+      0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, shm_fd, 0);
+  close(shm_fd);
+  if (pool == MAP_FAILED) {
+    printf("prod: Map failed: %s\n", strerror(errno));
+    exit(1);
+  }
+  adviseHugePages(pool, bytes);
+
+  if (created) pool->layout(memorySize, precision, generation);
+  weights.attach(pool->at(pool->weightsOffset), precision, 1.0, initialWeight);
+  colTab = &pool->colTab;
+
+  if (created) { // zero filled, holding initial weights
+    if (weightsFile.empty() || !loadWeights(weightsFile.c_str())) {
+      if (!weightsFile.empty()) weights.fill(memorySize, initialWeight);
+      colTab->reset(weightsFile.empty());
+    } else {
+      for (uint i = 1; i < checkpoints.size(); ++i) {
+        Checkpointer::applyDelta(checkpoints[i], weights, memorySize, colTab);
+      }
+    }
+  }
+
+  pool->attached += 1;
+  pool->learners.add(getpid());
+  cerr << "Joining weight pool " << weightPool << " (generation "
+       << pool->generation << ", " << pool->attached << " learners attached)"
+       << endl;
+  if (hugePages) reportPages("Weight pool", pool);
+}
+
+/**
+ * leave the weight pool, removing it with its last learner
+ */
+void LinearSarsaLearner::detachWeightPool() {
+  if (!pool) return;
+
+  FileLock lock(poolLock);
+  pool->attached -= 1;
+  pool->learners.remove(getpid());
+  if (pool->attached <= 0) shm_unlink(poolMemory.c_str());
+  munmap(pool, (size_t) WeightPool::size(memorySize, precision));
+  pool = 0;
+}
+
+void LinearSarsaLearner::setBarrierTimeout(int ms) { barrierTimeout = ms; }
+
+/**
+ * decentralized inference, when not learning: every agent computes the joint
+ * choice itself (see decide), keeping Q private and looking tiles up without
+ * inserting into the shared collision table
+ * @param on
+ * @param seed tie breaking seed, the same for all agents of the team
+ */
+void LinearSarsaLearner::setDecentralized(bool on, unsigned seed) {
+  if (on && bLearning) {
+    cerr << "Decentralized inference is ignored while learning" << endl;
+    on = false;
+  }
+
+  decentralized = on;
+  tieSeed = seed;
+  if (!decentralized) return;
+
+  localQ.assign(MAX_RL_ACTIONS, 0.0);
+  Q = localQ.data();
+  frozenColTab.attach(colTab->data(), memorySize);
+  frozenColTab.restoreStats(colTab->safe, 0, 0, 0);
+  frozenColTab.probing = colTab->probing;
+  frozenColTab.frozen = 1;
+  colTab = &frozenColTab;
+}
+
+/**
+ * checkpoint weights every so many episodes and/or seconds (0: never), into
+ * files named after the save weights file, keeping the last keep full
+ * checkpoints; deltas (dirty pages only) are written in between full ones
+ * @param episodes
+ * @param seconds
+ * @param keep
+ * @param deltas
+ */
+void LinearSarsaLearner::setCheckpoints(int episodes, int seconds, int keep,
+                                        int deltas) {
+  checkpointEpisodes = episodes;
+  checkpointSeconds = seconds;
+  checkpointKeep = keep;
+  checkpointDeltas = deltas;
+}
+
+/**
+ * record joint decisions and episode ends into filename (shared by all agents
+ * of the team, since any of them can make joint decisions)
+ * @param filename
+ * @return
+ */
+bool LinearSarsaLearner::setTransitionLog(const string &filename) {
+  TransitionLogHeader header;
+  header.setup(HierarchicalFSM::num_features, HierarchicalFSM::num_teammates,
+               HierarchicalFSM::num_opponents, teamName, tileWidths);
+  return transitions.openWrite(filename, header);
+}
+
+/**
+ * record the learner events of this agent into filename (shared by the team,
+ * see kwlogdump)
+ * @param filename
+ * @return
+ */
+bool LinearSarsaLearner::setEventLog(const string &filename) {
+  EventLogHeader header;
+  header.setup(HierarchicalFSM::num_teammates, teamName);
+  return events.openWrite(filename, header);
+}
+
+void LinearSarsaLearner::record(int kind, int tau, int choice) {
+  if (!transitions.isOpen()) return;
+
+  transition.kind = kind;
+  transition.tau = tau;
+  transition.choice = choice;
+  transition.numChoices.clear();
+  transition.state.clear();
+  if (kind == TransitionRecord::STEP) {
+    transition.machineState =
+        MachineStateTable::ins().jointHash(jointMachineState);
+    transition.numChoices = numChoices;
+    transition.state.assign(Memory::ins().state,
+                            Memory::ins().state + HierarchicalFSM::num_features);
+  } else {
+    transition.machineState = 0;
+  }
+  transitions.write(transition);
+}
+
+void LinearSarsaLearner::wait(BarrierId b, int current_time) {
+  TraceSpan span(CycleTrace::current(), TRACE_THINK_THREAD, TRACE_WAIT,
+                 current_time);
+  LOG(101, "LinearSarsaLearner::wait barrier %d", b);
+  int64_t start = events.isOpen() ? CycleTrace::now() : 0;
+  bool timeout = !sharedData->barriers[b].wait(HierarchicalFSM::num_teammates,
+                                               barrierTimeout);
+  if (timeout) {
+    LOG(101, "LinearSarsaLearner::wait barrier %d timeout", b);
+  }
+  if (events.isOpen()) {
+    events.write(EVENT_BARRIER_WAIT, current_time, b,
+                 (CycleTrace::now() - start) / 1000, timeout);
+  }
 }
 
 bool LinearSarsaLearner::loadSharedData() {
   numTilings = sharedData->numTilings;
   minimumTrace = sharedData->minimumTrace;
+  traceScale = sharedData->traceScale;
   numNonzeroTraces = sharedData->numNonzeroTraces;
-  lastJointChoiceIdx = sharedData->lastJointChoiceIdx;
-  lastJointChoiceTime = sharedData->lastJointChoiceTime;
-  lastJointChoice = sharedData->getLastJointChoice();
-  machineState = sharedData->getMachineState();
-  lastMachineState = sharedData->getLastMachineState();
-  numChoices = sharedData->getNumChoices();
-
-  Assert(!numChoicesMap.count(machineState) ||
-         numChoicesMap[machineState] == numChoices);
-  numChoicesMap[machineState] = numChoices;
+  sharedData->readDecision(decision);
+  lastJointChoiceIdx = decision.idx;
+  lastJointChoiceTime = decision.time;
+  lastJointChoice.assign(decision.choice,
+                         decision.choice + HierarchicalFSM::num_teammates);
+  lastMachineState.assign(decision.machineState, decision.machineState +
+                                                 HierarchicalFSM::num_teammates);
+  sharedData->getMachineState(machineState);
+  jointMachineState = MachineStateTable::ins().joint(machineState);
+  sharedData->getNumChoices(numChoices);
+
+  Assert(!numChoicesMap.count(jointMachineState) ||
+         numChoicesMap[jointMachineState] == numChoices);
+  numChoicesMap[jointMachineState] = numChoices;
 
   bool action_state = true; // action state (when all are in action)
   for (int i = 0; i < HierarchicalFSM::num_teammates; ++i) {
@@ -199,13 +986,13 @@ bool LinearSarsaLearner::loadSharedData() {
     }
   }
 
-  if (Log.isInLogLevel(101)) {
+  if (LOG_ENABLED(101)) {
     stringstream ss;
     PRINT_VALUE_STREAM(ss, Memory::ins().to_string());
     PRINT_VALUE_STREAM(ss, numTilings);
     PRINT_VALUE_STREAM(ss, minimumTrace);
     PRINT_VALUE_STREAM(ss, numNonzeroTraces);
-    PRINT_VALUE_STREAM(ss, machineState);
+    PRINT_VALUE_STREAM(ss, MachineStateTable::ins().jointStr(jointMachineState));
     PRINT_VALUE_STREAM(ss, lastMachineState);
     PRINT_VALUE_STREAM(ss, numChoices);
     PRINT_VALUE_STREAM(ss, action_state);
@@ -213,12 +1000,45 @@ bool LinearSarsaLearner::loadSharedData() {
     PRINT_VALUE_STREAM(ss, lastJointChoiceTime);
     PRINT_VALUE_STREAM(ss, lastJointChoice);
 
-    Log.log(101, "LinearSarsaLearner::loadSharedData\n%s", ss.str().c_str());
+    LOG(101, "LinearSarsaLearner::loadSharedData\n%s", ss.str().c_str());
   }
 
   return action_state;
 }
 
+/**
+ * load the joint decision agent 0 published last, which teammates read
+ * without waiting for each other (see SharedData::readDecision)
+ * @param current_time
+ * @param num_choices of the choice point of this agent
+ * @param round expected of the decision made on that choice point
+ * @return false (and counted) if the decision was not made on that choice
+ * point, e.g. an earlier one after a barrier timeout
+ */
+bool LinearSarsaLearner::loadDecision(int current_time, int num_choices,
+                                      unsigned round) {
+  int n = HierarchicalFSM::num_teammates;
+  sharedData->readDecision(decision);
+  lastJointChoiceIdx = decision.idx;
+  lastJointChoiceTime = decision.time;
+  lastJointChoice.assign(decision.choice, decision.choice + n);
+  lastMachineState.assign(decision.machineState, decision.machineState + n);
+
+  bool action_state = true;
+  for (int i = 0; i < n; ++i) {
+    if (decision.numChoices[i] > 1) action_state = false;
+  }
+  if (action_state || decision.idx < 0 || decision.round != round ||
+      decision.time != current_time ||
+      decision.numChoices[Memory::ins().agentIdx] != num_choices) {
+    __atomic_add_fetch(&sharedData->staleDecisions, 1, __ATOMIC_RELAXED);
+    LOG(101, "LinearSarsaLearner::loadDecision stale decision %d at %d",
+        decision.idx, decision.time);
+    return false;
+  }
+  return true;
+}
+
 void LinearSarsaLearner::saveSharedData() {
   Assert(numChoices.size());
   Assert(machineState.size());
@@ -226,55 +1046,24 @@ void LinearSarsaLearner::saveSharedData() {
 
   sharedData->numTilings = numTilings;
   sharedData->minimumTrace = minimumTrace;
+  sharedData->traceScale = traceScale;
   sharedData->numNonzeroTraces = numNonzeroTraces;
-  sharedData->lastJointChoiceIdx = lastJointChoiceIdx;
-  sharedData->lastJointChoiceTime = lastJointChoiceTime;
 
+  decision.round += 1; // as loaded at this choice point (see step)
+  decision.idx = lastJointChoiceIdx;
+  decision.time = lastJointChoiceTime;
   for (int i = 0; i < HierarchicalFSM::num_teammates; ++i) {
     sharedData->numChoices[Memory::ins().teammates[i]] = numChoices[i];
-    strcpy(sharedData->machineState[Memory::ins().teammates[i]],
-           machineState[i].c_str());
-    strcpy(sharedData->lastMachineState[i], lastMachineState[i].c_str());
-    sharedData->lastJointChoice[i] = lastJointChoice[i];
+    sharedData->machineState[Memory::ins().teammates[i]] = machineState[i];
+    decision.numChoices[i] = numChoices[i];
+    decision.choice[i] = lastJointChoice[i];
+    decision.machineState[i] = lastMachineState[i];
   }
-}
-
-const vector<int> &
-LinearSarsaLearner::validChoices(const num_choice_t &num_choices) {
-  Assert(num_choices.size() == HierarchicalFSM::num_teammates);
-  if (!validChoicesMap.count(num_choices) ||
-      !jointChoicesMap.count(num_choices)) {
-    jointChoicesMap[num_choices] = validChoicesRaw(num_choices);
-    for (uint i = 0; i < jointChoicesMap[num_choices].size(); ++i) {
-      Assert(jointChoicesMap[num_choices][i].size() ==
-             HierarchicalFSM::num_teammates);
-      validChoicesMap[num_choices].push_back(i);
-    }
-  }
-  return validChoicesMap[num_choices];
-}
-
-vector<choice_t>
-LinearSarsaLearner::validChoicesRaw(const num_choice_t &num_choices) {
-  if (num_choices.empty())
-    return {{}};
-
-  vector<choice_t> ret;
-  auto c = validChoicesRaw({num_choices.begin() + 1, num_choices.end()});
-  Assert(num_choices[0] > 0);
-  for (int i = 0; i < num_choices[0]; ++i) {
-    for (auto &v : c) {
-      vector<int> r{i};
-      r.insert(r.end(), v.begin(), v.end());
-      ret.push_back(r);
-    }
-  }
-
-  return ret;
+  sharedData->publish(decision);
 }
 
 double LinearSarsaLearner::reward(double tau) {
-  Log.log(101, "LinearSarsaLearner::reward tau=%f", tau);
+  LOG(101, "LinearSarsaLearner::reward tau=%f", tau);
   double ret = tau;
 
   if (gamma < 1.0) {
@@ -287,17 +1076,21 @@ double LinearSarsaLearner::reward(double tau) {
 int LinearSarsaLearner::step(int current_time) {
   int choice = -1;
   auto *state = Memory::ins().state;
+  int numJoint = JointChoices(numChoices).size();
 
   if (lastJointChoiceIdx >= 0) {
     Assert(lastJointChoiceTime != UnknownTime);
     double tau = current_time - lastJointChoiceTime;
     double delta = reward(tau) - Q[lastJointChoiceIdx];
-    numTilings = loadTiles(state, machineState, numChoices, tiles_);
-    for (auto c : validChoices(numChoices)) {
-      Q[c] = QValue(state, machineState, c, tiles_, numTilings);
+    numTilings = loadTiles(state, jointMachineState, numChoices, tiles_);
+    for (int c = 0; c < numJoint; c++) {
+      Q[c] = QValue(state, jointMachineState, c, tiles_, numTilings);
     }
 
     choice = selectChoice(numChoices);
+    if (events.isOpen()) {
+      events.write(EVENT_Q_VALUES, current_time, 0, 0, 0, Q, numJoint);
+    }
     if (!bLearning)
       return choice;
     Assert(!std::isnan(Q[choice]) && !std::isinf(Q[choice]));
@@ -309,10 +1102,13 @@ int LinearSarsaLearner::step(int current_time) {
     }
 
     updateWeights(delta, numTilings);
-    Q[choice] = QValue(state, machineState, choice, tiles_, numTilings);
+    if (events.isOpen()) {
+      events.write(EVENT_UPDATE, current_time, delta, numNonzeroTraces);
+    }
+    Q[choice] = QValue(state, jointMachineState, choice, tiles_, numTilings);
 
     decayTraces(gamma * lambda);
-    for (auto a : validChoices(numChoices)) {
+    for (int a = 0; a < numJoint; a++) {
       if (a != choice) {
         for (int j = 0; j < numTilings; j++)
           clearTrace(tiles_[a][j]);
@@ -321,11 +1117,14 @@ int LinearSarsaLearner::step(int current_time) {
   } else { // new episode
     decayTraces(0.0);
     Assert(numNonzeroTraces == 0);
-    numTilings = loadTiles(state, machineState, numChoices, tiles_);
-    for (auto c : validChoices(numChoices)) {
-      Q[c] = QValue(state, machineState, c, tiles_, numTilings);
+    numTilings = loadTiles(state, jointMachineState, numChoices, tiles_);
+    for (int c = 0; c < numJoint; c++) {
+      Q[c] = QValue(state, jointMachineState, c, tiles_, numTilings);
     }
     choice = selectChoice(numChoices);
+    if (events.isOpen()) {
+      events.write(EVENT_Q_VALUES, current_time, 0, 0, 0, Q, numJoint);
+    }
   }
 
   for (int j = 0; j < numTilings; j++)
@@ -342,102 +1141,241 @@ int LinearSarsaLearner::step(int current_time) {
  */
 int LinearSarsaLearner::step(int current_time, int num_choices) {
   SCOPED_LOG
-  auto stackStr = HierarchicalFSM::getStackStr();
+  TraceSpan span(CycleTrace::current(), TRACE_THINK_THREAD, TRACE_STEP,
+                 current_time);
+  auto stackId = Memory::ins().getStackId();
   sharedData->numChoices[Memory::ins().teammates[Memory::ins().agentIdx]] = num_choices;
-  strcpy(sharedData->machineState[Memory::ins().teammates[Memory::ins().agentIdx]],
-         stackStr.c_str());
+  sharedData->machineState[Memory::ins().teammates[Memory::ins().agentIdx]] = stackId;
+  sharedData->publishChoicePoint(
+      Memory::ins().teammates[Memory::ins().agentIdx], current_time,
+      num_choices, stackId);
+  if (events.isOpen()) {
+    events.setAgent(SoccerTypes::getIndex(
+        Memory::ins().teammates[Memory::ins().agentIdx]) + 1);
+    events.write(EVENT_CHOICE_POINT, current_time, stackId, num_choices);
+  }
+  if (decentralized) return decide(current_time, num_choices);
 
-  Log.log(101, "LinearSarsaLearner::step agent %d write numChoices %d",
-          Memory::ins().agentIdx, num_choices);
-  Log.log(101, "LinearSarsaLearner::step agent %d write machineState %s",
-          Memory::ins().agentIdx, stackStr.c_str());
+  LOG(101, "LinearSarsaLearner::step agent %d write numChoices %d",
+      Memory::ins().agentIdx, num_choices);
+  LOG(101, "LinearSarsaLearner::step agent %d write machineState %s",
+      Memory::ins().agentIdx, HierarchicalFSM::getStackStr().c_str());
 
-  barriers["enter1"]->wait();
+  wait(BARRIER_ENTER1, current_time);
   bool action_state = loadSharedData();
-  barriers["exit1"]->wait();
+  unsigned round = decision.round + 1; // of the decision on this choice point
+  wait(BARRIER_EXIT1, current_time);
 
   if (action_state) {
     return 0; // action state
   } else {
     if (Memory::ins().agentIdx == 0) {
+      int tau = lastJointChoiceIdx >= 0 ? current_time - lastJointChoiceTime
+                                        : -1;
       lastJointChoiceIdx = step(current_time);
+      record(TransitionRecord::STEP, tau, lastJointChoiceIdx);
+      if (events.isOpen()) {
+        events.write(EVENT_JOINT_CHOICE, current_time,
+                     (unsigned) MachineStateTable::ins().jointHash(
+                         jointMachineState), lastJointChoiceIdx, tau);
+      }
       lastJointChoiceTime = current_time;
-      lastJointChoice = jointChoicesMap[numChoices][lastJointChoiceIdx];
+      JointChoices(numChoices).decode(lastJointChoiceIdx, lastJointChoice);
       lastMachineState = machineState;
       saveSharedData();
     }
 
-    barriers["enter2"]->wait();
-    bool action_state2 = loadSharedData();
-    barriers["exit2"]->wait();
+    // once published, the decision is read as one record: agent 0 cannot
+    // overwrite it before all agents enter the next choice point
+    wait(BARRIER_ENTER2, current_time);
+    if (!loadDecision(current_time, num_choices, round)) return 0;
 
-    if (action_state2 == action_state) {
-      if (numChoices[Memory::ins().agentIdx] <= 1) { // dummy choice
-        return step(current_time, num_choices);
-      } else {
-        Assert(lastJointChoice.size() == HierarchicalFSM::num_teammates);
-        return lastJointChoice[Memory::ins().agentIdx];
-      }
-    } else { // race condition?
-      return 0;
+    if (num_choices <= 1) { // dummy choice
+      return step(current_time, num_choices);
     }
+    return lastJointChoice[Memory::ins().agentIdx];
+  }
+}
+
+/**
+ * the joint choice maximizing Q given the machine states teammates published
+ * last, computed by every agent with the same weights and state, and ties
+ * broken the same way; each agent takes its own component without waiting
+ * for the others
+ * note: agents agree only if all published their choice points of the same
+ * cycle; a decision on a teammate's choice point of another cycle (not
+ * published yet, or already the next one) is made anyway and counted as stale
+ * @param current_time
+ * @param num_choices
+ * @return
+ */
+int LinearSarsaLearner::decide(int current_time, int num_choices) {
+  if (num_choices <= 1) return 0; // dummy choice
+
+  int n = HierarchicalFSM::num_teammates;
+  numChoices.resize((unsigned long) n);
+  machineState.resize((unsigned long) n);
+  bool stale = false;
+  PublishedChoicePoint c;
+  for (int i = 0; i < n; ++i) {
+    sharedData->readChoicePoint(Memory::ins().teammates[i], c);
+    numChoices[i] = max(c.numChoices, 1); // not published yet
+    machineState[i] = c.machineState;
+    if (c.time != current_time) stale = true;
+  }
+  __atomic_add_fetch(&sharedData->decisions, 1, __ATOMIC_RELAXED);
+  if (stale) {
+    __atomic_add_fetch(&sharedData->staleChoicePoints, 1, __ATOMIC_RELAXED);
+    LOG(101, "LinearSarsaLearner::decide stale choice points at %d",
+        current_time);
+  }
+
+  jointMachineState = MachineStateTable::ins().joint(machineState);
+
+  tieRng.seed(tieSeed ^ (unsigned) current_time * 2654435761u ^
+              (unsigned) MachineStateTable::ins().jointHash(jointMachineState));
+
+  auto *state = Memory::ins().state;
+  JointChoices joint(numChoices);
+  numTilings = loadTiles(state, jointMachineState, numChoices, tiles_);
+  for (int c = 0; c < joint.size(); c++) {
+    Q[c] = QValue(state, jointMachineState, c, tiles_, numTilings);
   }
+
+  int choice = argmaxQ(numChoices);
+  LOG(101, "LinearSarsaLearner::decide joint choice %d", choice);
+  if (events.isOpen()) {
+    events.write(EVENT_Q_VALUES, current_time, 0, 0, 0, Q, joint.size());
+    events.write(EVENT_JOINT_CHOICE, current_time,
+                 (unsigned) MachineStateTable::ins().jointHash(
+                     jointMachineState), choice, -1);
+  }
+  return joint.choice(choice, Memory::ins().agentIdx);
 }
 
 void LinearSarsaLearner::endEpisode(int current_time) {
   SCOPED_LOG
+  if (events.isOpen()) {
+    events.write(EVENT_EPISODE_END, current_time,
+                 lastJointChoiceIdx >= 0 ? current_time - lastJointChoiceTime
+                                         : -1);
+  }
 
-  barriers["reset"]->wait(); // recover from non synchronization (if any)
+  if (decentralized) { // nothing shared to reset
+    lastJointChoiceIdx = -1;
+    lastJointChoiceTime = UnknownTime;
+    return;
+  }
+
+  wait(BARRIER_RESET, current_time); // recover from non synchronization
   if (Memory::ins().agentIdx == 0) { // only one agent can update
     loadSharedData();
-
-    if (bLearning && lastJointChoiceIdx >= 0) {
-      Assert(numTilings > 0);
-      Assert(lastJointChoiceTime != UnknownTime);
-      Assert(lastJointChoiceTime <= current_time);
-      double tau = current_time - lastJointChoiceTime;
-      double delta = reward(tau) - Q[lastJointChoiceIdx];
-      updateWeights(delta, numTilings);
+    record(TransitionRecord::END, lastJointChoiceIdx >= 0
+                                  ? current_time - lastJointChoiceTime : -1,
+           -1);
+    terminalUpdate(current_time);
+
+    if (bSaveWeights && (checkpointEpisodes > 0 || checkpointSeconds > 0)) {
+      if (!checkpointer) {
+        checkpointer = new Checkpointer(saveWeightsFile, checkpointEpisodes,
+                                        checkpointSeconds, checkpointKeep,
+                                        checkpointDeltas);
+      }
+      checkpointer->endEpisode(weights, memorySize, colTab);
     }
 
     lastJointChoiceIdx = -1;
     lastJointChoiceTime = UnknownTime;
-    fill(lastMachineState.begin(), lastMachineState.end(), "");
-    fill(machineState.begin(), machineState.end(), "");
+    fill(lastMachineState.begin(), lastMachineState.end(), EMPTY_STACK);
+    fill(machineState.begin(), machineState.end(), EMPTY_STACK);
     fill(numChoices.begin(), numChoices.end(), 1);
     fill(lastJointChoice.begin(), lastJointChoice.end(), 0);
     saveSharedData();
   }
 
-  barriers["enter2"]->wait();
+  wait(BARRIER_ENTER2, current_time);
   loadSharedData();
-  barriers["exit2"]->wait();
+  wait(BARRIER_EXIT2, current_time);
 }
 
-int LinearSarsaLearner::loadTiles(double state[],
-                                  const machine_state_t &machine_state,
-                                  const num_choice_t &num_choices,
-                                  int (*tiles)[RL_MAX_NUM_TILINGS]) {
-  const int tilingsPerGroup = 32;
+void LinearSarsaLearner::terminalUpdate(int current_time) {
+  if (bLearning && lastJointChoiceIdx >= 0) {
+    Assert(numTilings > 0);
+    Assert(lastJointChoiceTime != UnknownTime);
+    Assert(lastJointChoiceTime <= current_time);
+    double tau = current_time - lastJointChoiceTime;
+    double delta = reward(tau) - Q[lastJointChoiceIdx];
+    updateWeights(delta, numTilings);
+    if (events.isOpen()) {
+      events.write(EVENT_UPDATE, current_time, delta, numNonzeroTraces);
+    }
+  }
+}
+
+/**
+ * learn offline from a recorded transition, taking the recorded choice
+ * @param r
+ */
+void LinearSarsaLearner::replay(const TransitionRecord &r) {
+  if (r.tau < 0) { // start of an episode
+    lastJointChoiceIdx = -1;
+    lastJointChoiceTime = UnknownTime;
+  }
+  int current_time = lastJointChoiceIdx >= 0 ? lastJointChoiceTime + r.tau : 0;
+
+  if (r.kind == TransitionRecord::STEP) {
+    copy(r.state.begin(), r.state.end(), Memory::ins().state);
+    jointMachineState = MachineStateTable::ins().jointOfHash(r.machineState);
+    numChoices = r.numChoices;
+    replayChoice = r.choice;
+    lastJointChoiceIdx = step(current_time);
+    replayChoice = -1;
+    lastJointChoiceTime = current_time;
+  } else {
+    terminalUpdate(current_time);
+    lastJointChoiceIdx = -1;
+    lastJointChoiceTime = UnknownTime;
+  }
+}
 
-  int h = (int) (hash<string>()(to_prettystring(machine_state)) %
-                 INT_MAX); // joint machine state
-  Log.log(101, "LinearSarsaLearner::loadTiles machine state: [%s], "
-              "num_choices=%d, (hash=%d)",
-          to_prettystring(machine_state).c_str(),
-          validChoices(num_choices).size(), h);
+/**
+ * tiles of the joint choices of a recorded decision, as this learner codes
+ * them (e.g. to compare weight tables offline)
+ * @param r
+ * @param tiles
+ * @return number of tilings
+ */
+int LinearSarsaLearner::recordTiles(const TransitionRecord &r,
+                                    TileArena &tiles) {
+  double state[MAX_RL_STATE_VARS];
+  copy(r.state.begin(), r.state.end(), state);
+  int machine_state = MachineStateTable::ins().jointOfHash(r.machineState);
+  return loadTiles(state, machine_state, r.numChoices, tiles);
+}
 
+int LinearSarsaLearner::loadTiles(double state[],
+                                  int machine_state,
+                                  const num_choice_t &num_choices,
+                                  TileArena &tiles) {
+  int h = MachineStateTable::ins().jointHash(machine_state); // joint machine state
+  LOG(101, "LinearSarsaLearner::loadTiles machine state: [%s], "
+          "num_choices=%d, (hash=%d)",
+      MachineStateTable::ins().jointStr(machine_state).c_str(),
+      JointChoices(num_choices).size(), h);
+
+  // valid choices are 0..n-1, so tiles of choice a are returned in tiles[a]
+  int n = JointChoices(num_choices).size();
+  tiles.reserve(HierarchicalFSM::num_features * tilingsPerGroup, n);
   int numTilings = 0;
   for (int v = 0; v < HierarchicalFSM::num_features; v++) {
-    for (auto a : validChoices(num_choices)) {
-      GetTiles1(&(tiles[a][numTilings]), tilingsPerGroup, colTab,
-                (float) (state[v] / tileWidths[v]), a, v, h);
-    }
+    GetTiles1Batch(tiles[0] + numTilings, tiles.getStride(),
+                   tilingsPerGroup, colTab, (float) (state[v] / tileWidths[v]),
+                   JointChoices::ids(), n, v, h);
     numTilings += tilingsPerGroup;
   }
 
   Assert(numTilings > 0);
-  Assert(numTilings < RL_MAX_NUM_TILINGS);
+  Assert(numTilings <= tiles.getStride());
   return numTilings;
 }
 
@@ -451,69 +1389,82 @@ int LinearSarsaLearner::loadTiles(double state[],
  * @return
  */
 double LinearSarsaLearner::QValue(double *state,
-                                  const machine_state_t &machine_state,
-                                  int choice, int (*tiles)[RL_MAX_NUM_TILINGS],
+                                  int machine_state,
+                                  int choice, const TileArena &tiles,
                                   int num_tilings) {
   auto q = computeQ(choice, tiles, num_tilings);
-  Log.log(101, "LinearSarsaLearner::QValue: Q(s, m=%s, c=%d) = %f",
-          to_prettystring(machine_state).c_str(), choice, q);
+  LOG(101, "LinearSarsaLearner::QValue: Q(s, m=%s, c=%d) = %f",
+      MachineStateTable::ins().jointStr(machine_state).c_str(), choice, q);
   return q;
 }
 
 double LinearSarsaLearner::computeQ(int choice,
-                                    int (*tiles)[RL_MAX_NUM_TILINGS],
+                                    const TileArena &tiles,
                                     int numTilings) {
+  const int *t = tiles[choice];
+  if (weights.getPrecision() == PRECISION_INT16) { // quantized: sum ints
+    const short *w = (const short *) weights.raw();
+    int sum = 0;
+    for (int j = 0; j < numTilings; j++) {
+      sum += w[t[j]];
+    }
+    return numTilings * weights.getOffset() + weights.getScale() * sum;
+  }
+
   double q = 0.0;
   for (int j = 0; j < numTilings; j++) {
-    q += weights[tiles[choice][j]];
+    q += weights[t[j]];
   }
 
   return q;
 }
 
 double LinearSarsaLearner::Value(double *state,
-                                 const machine_state_t &machine_state) {
-  auto tiles = new int[MAX_RL_ACTIONS][RL_MAX_NUM_TILINGS];
+                                 int machine_state) {
   double v = numeric_limits<double>::min();
 
   Assert(numChoicesMap.count(machine_state));
-  auto num_choices = numChoicesMap[machine_state];
-  int num_tilings = loadTiles(state, machine_state, num_choices, tiles);
+  auto &num_choices = numChoicesMap[machine_state];
+  int num_tilings = loadTiles(state, machine_state, num_choices, valueTiles);
 
-  for (auto c : validChoices(num_choices)) {
-    double tmp = QValue(state, machine_state, c, tiles, num_tilings);
+  int n = JointChoices(num_choices).size();
+  for (int c = 0; c < n; c++) {
+    double tmp = QValue(state, machine_state, c, valueTiles, num_tilings);
     if (tmp > v) {
       v = tmp;
     }
   }
 
-  Log.log(101, "LinearSarsaLearner::Value: V(s, m=%s) = %f",
-          to_prettystring(machine_state).c_str(), v);
-  delete[] tiles;
+  LOG(101, "LinearSarsaLearner::Value: V(s, m=%s) = %f",
+      MachineStateTable::ins().jointStr(machine_state).c_str(), v);
   return v;
 }
 
 int LinearSarsaLearner::selectChoice(const num_choice_t &num_choices) {
   int choice = -1;
 
-  if (Log.isInLogLevel(101)) {
+  JointChoices joint(num_choices);
+  if (LOG_ENABLED(101)) {
+    vector<choice_t> jointChoices((size_t) joint.size());
+    for (int c = 0; c < joint.size(); ++c) {
+      joint.decode(c, jointChoices[c]);
+    }
     stringstream ss;
-    PRINT_VALUE_STREAM(ss, validChoices(num_choices));
-    PRINT_VALUE_STREAM(ss, validChoices(num_choices).size());
-    PRINT_VALUE_STREAM(ss, jointChoicesMap[num_choices]);
-    PRINT_VALUE_STREAM(ss,
-                       vector<double>(Q, Q + validChoices(num_choices).size()));
-    Log.log(101, "LinearSarsaLearner::selectChoice %s", ss.str().c_str());
-    Log.log(101, "LinearSarsaLearner::selectChoice numTilings: %d", numTilings);
-  }
-
-  if (bLearning && drand48() < epsilon) { /* explore */
-    auto &choices = validChoices(num_choices);
-    choice = choices[rand() % choices.size()];
-    Log.log(101, "LinearSarsaLearner::selectChoice explore choice %d", choice);
+    PRINT_VALUE_STREAM(ss, joint.size());
+    PRINT_VALUE_STREAM(ss, jointChoices);
+    PRINT_VALUE_STREAM(ss, vector<double>(Q, Q + joint.size()));
+    LOG(101, "LinearSarsaLearner::selectChoice %s", ss.str().c_str());
+    LOG(101, "LinearSarsaLearner::selectChoice numTilings: %d", numTilings);
+  }
+
+  if (replayChoice >= 0) {
+    choice = replayChoice;
+  } else if (bLearning && rng.uniform() < epsilon) { /* explore */
+    choice = rng.below(joint.size());
+    LOG(101, "LinearSarsaLearner::selectChoice explore choice %d", choice);
   } else {
     choice = argmaxQ(num_choices);
-    Log.log(101, "LinearSarsaLearner::selectChoice argmaxQ choice %d", choice);
+    LOG(101, "LinearSarsaLearner::selectChoice argmaxQ choice %d", choice);
   }
 
   return choice;
@@ -524,14 +1475,16 @@ int LinearSarsaLearner::argmaxQ(const num_choice_t &num_choices) {
   double bestValue = (double) INT_MIN;
   int numTies = 0;
 
-  for (auto a : validChoices(num_choices)) {
+  int n = JointChoices(num_choices).size();
+  for (int a = 0; a < n; a++) {
     double value = Q[a];
     if (value > bestValue) {
       bestValue = value;
       bestAction = a;
     } else if (value == bestValue) {
       numTies++;
-      if (rand() % (numTies + 1) == 0) {
+      Rng &r = decentralized ? tieRng : rng;
+      if (r.below(numTies + 1) == 0) {
         bestValue = value;
         bestAction = a;
       }
@@ -543,45 +1496,77 @@ int LinearSarsaLearner::argmaxQ(const num_choice_t &num_choices) {
 }
 
 void LinearSarsaLearner::updateWeights(double delta, int num_tilings) {
-  Log.log(101, "LinearSarsaLearner::updateWeights delta %f", delta);
+  LOG(101, "LinearSarsaLearner::updateWeights delta %f", delta);
 
   Assert(num_tilings > 0);
   double tmp = delta * alpha / num_tilings;
 
-  for (int i = 0; i < numNonzeroTraces; i++) {
+  // traces decayed below minimumTrace are pruned here (necessary to loop
+  // downwards)
+  for (int i = numNonzeroTraces - 1; i >= 0; i--) {
     Assert(i < RL_MAX_NONZERO_TRACES);
 
     int f = nonzeroTraces[i];
     Assert(f >= 0);
-    Assert(f < RL_MEMORY_SIZE);
+    Assert(f < memorySize);
 
-    if (f >= RL_MEMORY_SIZE || f < 0) {
+    if (f >= memorySize || f < 0) {
       continue;
     }
 
-    weights[f] += tmp * traces[f];
+    double e = trace(f);
+    if (e < minimumTrace) {
+      clearExistentTrace(f, i);
+      continue;
+    }
+
+    weights.add(f, tmp * e);
+    colTab->touch(f);
     Assert(!std::isnan(weights[f]));
     Assert(!std::isinf(weights[f]));
   }
 }
 
+/**
+ * traces are stored relative to traceScale, so that decaying all of them is
+ * a multiplication of traceScale; they are only rescaled when traceScale gets
+ * too small, or cleared when decayRate is 0 (new episode)
+ * @param decayRate
+ */
 void LinearSarsaLearner::decayTraces(double decayRate) {
+  if (decayRate <= 0.0) {
+    for (int loc = numNonzeroTraces - 1; loc >= 0; loc--) {
+      clearExistentTrace(nonzeroTraces[loc], loc);
+    }
+    traceScale = 1.0;
+    return;
+  }
+
+  traceScale *= decayRate;
+  if (traceScale < MIN_TRACE_SCALE) compactTraces();
+}
+
+/**
+ * apply traceScale to the stored traces, pruning those below minimumTrace
+ */
+void LinearSarsaLearner::compactTraces() {
   for (int loc = numNonzeroTraces - 1; loc >= 0; loc--) {
     int f = nonzeroTraces[loc];
-    if (f >= RL_MEMORY_SIZE || f < 0) {
+    if (f >= memorySize || f < 0) {
       Assert(0);
-      cerr << "DecayTraces: f out of range " << f << endl;
+      cerr << "CompactTraces: f out of range " << f << endl;
       continue;
     }
 
-    traces[f] *= decayRate;
-    if (traces[f] < minimumTrace)
-      clearExistentTrace(f, loc);
+    double e = trace(f);
+    if (e < minimumTrace) clearExistentTrace(f, loc);
+    else traces.set(f, e);
   }
+  traceScale = 1.0;
 }
 
 void LinearSarsaLearner::clearTrace(int f) {
-  if (f >= RL_MEMORY_SIZE || f < 0) {
+  if (f >= memorySize || f < 0) {
     Assert(0);
     cerr << "ClearTrace: f out of range " << f << endl;
     return;
@@ -592,39 +1577,42 @@ void LinearSarsaLearner::clearTrace(int f) {
 }
 
 void LinearSarsaLearner::clearExistentTrace(int f, int loc) {
-  if (f >= RL_MEMORY_SIZE || f < 0) {
+  if (f >= memorySize || f < 0) {
     Assert(0);
     cerr << "ClearExistentTrace: f out of range " << f << endl;
     return;
   }
 
-  traces[f] = 0.0;
+  traces.set(f, 0.0);
 
   if (numNonzeroTraces > 0) {
     numNonzeroTraces--;
     nonzeroTraces[loc] = nonzeroTraces[numNonzeroTraces];
     nonzeroTracesInverse[nonzeroTraces[loc]] = loc;
   } else {
-    fill(traces, traces + RL_MEMORY_SIZE, 0.0);
+    traces.fill(memorySize, 0.0);
     Assert(numNonzeroTraces == 0);
   }
 }
 
 void LinearSarsaLearner::setTrace(int f, float newTraceValue) {
-  if (f >= RL_MEMORY_SIZE || f < 0) {
+  if (f >= memorySize || f < 0) {
     Assert(0);
     cerr << "SetTraces: f out of range " << f << endl;
     return;
   }
 
-  if (traces[f] >= minimumTrace) {
-    traces[f] = newTraceValue; // trace already exists
+  if (traces[f] != 0) {
+    traces.set(f, newTraceValue / traceScale); // trace already exists
   } else {
+    if (numNonzeroTraces >= RL_MAX_NONZERO_TRACES) {
+      compactTraces(); // prune decayed traces first
+    }
     while (numNonzeroTraces >= RL_MAX_NONZERO_TRACES) {
       increaseMinTrace(); // ensure room for new trace
     }
 
-    traces[f] = newTraceValue;
+    traces.set(f, newTraceValue / traceScale);
     Assert(numNonzeroTraces >= 0);
     Assert(numNonzeroTraces < RL_MAX_NONZERO_TRACES);
     nonzeroTraces[numNonzeroTraces] = f;
@@ -639,12 +1627,109 @@ void LinearSarsaLearner::increaseMinTrace() {
   for (int loc = numNonzeroTraces - 1; loc >= 0;
        loc--) { // necessary to loop downwards
     int f = nonzeroTraces[loc];
-    if (traces[f] < minimumTrace)
+    if (trace(f) < minimumTrace)
       clearExistentTrace(f, loc);
   }
 }
 
+/**
+ * read n reals stored with precision prec into weights starting at index
+ * offset, converting to the precision (and offset) of the table if needed
+ * @param sparse weights are zero filled: reals equal to their offset are
+ * skipped, so that their pages are not touched
+ */
+void LinearSarsaLearner::readReals(istream &is, RealArray &weights, int offset,
+                                   int n, Precision prec, bool sparse) {
+  bool raw = prec == weights.getPrecision() && weights.getOffset() == 0.0;
+  if (raw && !sparse) {
+    is.read((char *) weights.raw() + (long) offset * prec, (long) n * prec);
+    return;
+  }
+
+  const int chunk = 4096;
+  char buf[chunk * sizeof(double)];
+  for (int i = 0; i < n && is.good(); i += chunk) {
+    int m = min(chunk, n - i);
+    is.read(buf, (long) m * prec);
+    if (raw) { // stored as they are: zero pages (initial weights) are skipped
+      static const char zeros[MappedWeightsHeader::ALIGNMENT] = {};
+      const long page = MappedWeightsHeader::ALIGNMENT;
+      char *dst = (char *) weights.raw() + (long) (offset + i) * prec;
+      long bytes = (long) m * prec;
+      for (long j = 0; j < bytes; j += page) {
+        long l = min(page, bytes - j);
+        if (memcmp(buf + j, zeros, (size_t) l) != 0)
+          memcpy(dst + j, buf + j, (size_t) l);
+      }
+      continue;
+    }
+    for (int k = 0; k < m; ++k) {
+      double v = prec == PRECISION_FLOAT ? ((float *) buf)[k]
+                                         : ((double *) buf)[k];
+      if (sparse && v == weights.getOffset()) continue;
+      weights.set(offset + i + k, v);
+    }
+  }
+}
+
+/**
+ * write n reals stored relative to offset with precision prec (as reals)
+ */
+void LinearSarsaLearner::writeReals(ostream &os, const void *reals, int n,
+                                    Precision prec, double offset) {
+  if (offset == 0.0) {
+    os.write((const char *) reals, (long) n * prec);
+    return;
+  }
+
+  const int chunk = 4096;
+  char buf[chunk * sizeof(double)];
+  for (int i = 0; i < n; i += chunk) {
+    int m = min(chunk, n - i);
+    for (int k = 0; k < m; ++k) {
+      if (prec == PRECISION_FLOAT)
+        ((float *) buf)[k] = (float) (offset + ((const float *) reals)[i + k]);
+      else
+        ((double *) buf)[k] = offset + ((const double *) reals)[i + k];
+    }
+    os.write(buf, (long) m * prec);
+  }
+}
+
+/**
+ * read the header of a weight file; files without one are legacy files
+ * holding RL_MEMORY_SIZE doubles
+ * @return false if the file can not be read
+ */
+bool LinearSarsaLearner::peekWeights(const char *filename,
+                                     WeightsHeader &header) {
+  FileLock lock("loadWeights");
+
+#ifdef _Compress
+  igzstream is;
+#else
+  ifstream is;
+#endif
+
+  is.open(filename);
+  if (!is.good()) return false;
+
+  is.read((char *) &header, sizeof(WeightsHeader));
+  bool ok = is.good() || is.gcount() > 0;
+  is.close();
+  if (ok && !header.valid()) {
+    header.setup(RL_MEMORY_SIZE, PRECISION_DOUBLE);
+    header.version = 0;
+  }
+  return ok;
+}
+
 bool LinearSarsaLearner::loadWeights(const char *filename) {
+  MappedWeightsHeader mappedHeader;
+  if (peekMappedWeights(filename, mappedHeader)) {
+    return loadMappedWeights(filename);
+  }
+
   FileLock lock("loadWeights");
   cerr << "Loading weights from " << filename << endl;
 
@@ -660,14 +1745,58 @@ bool LinearSarsaLearner::loadWeights(const char *filename) {
     return false;
   }
 
-  is.read((char *) weights, RL_MEMORY_SIZE * sizeof(double));
-  colTab->restore(is);
+  if (!readWeights(is, weights, memorySize, colTab)) return false;
   is.close();
   cerr << "...done" << endl;
   return true;
 }
 
+/**
+ * read weights and collision table in the (compressed) stream format, or in
+ * the legacy format without header, into zero filled weights
+ */
+bool LinearSarsaLearner::readWeights(istream &is, RealArray &weights,
+                                     int memorySize, collision_table *colTab) {
+  WeightsHeader header;
+  is.read((char *) &header, sizeof(WeightsHeader));
+  if (header.valid()) {
+    if (header.memorySize != memorySize) {
+      cerr << "weight file memory size " << header.memorySize
+           << " does not match " << memorySize << endl;
+      return false;
+    }
+    readReals(is, weights, 0, memorySize, (Precision) header.precision, true);
+  } else { // legacy file without header
+    if (memorySize != RL_MEMORY_SIZE) {
+      cerr << "legacy weight file requires memory size " << RL_MEMORY_SIZE
+           << endl;
+      return false;
+    }
+    const int n = sizeof(WeightsHeader) / sizeof(double);
+    for (int i = 0; i < n; ++i) {
+      weights.set(i, ((double *) &header)[i]);
+    }
+    readReals(is, weights, n, memorySize - n, PRECISION_DOUBLE, true);
+  }
+
+  bool wide = !header.valid() || header.version < 2;
+  colTab->restore(is, wide, !header.valid() || header.version < 3);
+  colTab->probing = wide ? collision_table::PROBING_DOUBLE : header.colTabProbing;
+  return true;
+}
+
+/**
+ * save weights into an uncompressed (mapped) weight file, or into a gz file
+ * (for export) if filename ends with .gz
+ * @param filename
+ * @return
+ */
 bool LinearSarsaLearner::saveWeights(const char *filename) {
+  string name = filename;
+  if (name.length() < 3 || name.compare(name.length() - 3, 3, ".gz") != 0) {
+    return saveMappedWeights(filename);
+  }
+
   FileLock lock("saveWeights");
 
 #ifdef _Compress
@@ -682,9 +1811,189 @@ bool LinearSarsaLearner::saveWeights(const char *filename) {
     return false;
   }
 
-  os.write((char *) weights, RL_MEMORY_SIZE * sizeof(double));
+  writeWeights(os, weights.raw(), memorySize, precision, colTab,
+               weights.getOffset());
+  os.close();
+  return true;
+}
+
+/**
+ * write weights (stored relative to offset) and collision table in the
+ * (compressed) stream format
+ */
+void LinearSarsaLearner::writeWeights(ostream &os, const void *weights,
+                                      int memorySize, Precision precision,
+                                      collision_table *colTab, double offset) {
+  WeightsHeader header;
+  header.setup(memorySize, precision);
+  header.colTabProbing = colTab->probing;
+  os.write((char *) &header, sizeof(WeightsHeader));
+  writeReals(os, weights, memorySize, precision, offset);
   colTab->save(os);
+}
+
+/**
+ * read the header of an uncompressed weight file
+ * @return false if the file can not be read or is of another format
+ */
+bool LinearSarsaLearner::peekMappedWeights(const char *filename,
+                                           MappedWeightsHeader &header) {
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) return false;
+
+  auto n = read(fd, &header, sizeof(MappedWeightsHeader));
+  close(fd);
+  return n == sizeof(MappedWeightsHeader) && header.valid();
+}
+
+/**
+ * map an uncompressed weight file read only; pages are loaded on demand and
+ * shared by all processes mapping the same file
+ * @param filename
+ * @param header
+ * @return start of the file, or 0 on failure
+ */
+const char *LinearSarsaLearner::mapWeights(const char *filename,
+                                           MappedWeightsHeader &header) {
+  int fd = open(filename, O_RDONLY);
+  if (fd == -1) {
+    cerr << "failed to open weight file: " << filename << endl;
+    return 0;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t) sizeof(header) ||
+      pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      !header.valid() || st.st_size < header.fileSize) {
+    cerr << "invalid weight file: " << filename << endl;
+    close(fd);
+    return 0;
+  }
+
+  void *p = mmap(0, (size_t) header.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) {
+    printf("prod: Map failed: %s\n", strerror(errno));
+    return 0;
+  }
+  return (const char *) p;
+}
+
+bool LinearSarsaLearner::loadMappedWeights(const char *filename) {
+  cerr << "Loading weights from " << filename << endl;
+
+  MappedWeightsHeader header;
+  const char *file = mapWeights(filename, header);
+  if (!file) return false;
+
+  if (header.memorySize != memorySize) {
+    cerr << "weight file memory size " << header.memorySize
+         << " does not match " << memorySize << endl;
+    munmap((void *) file, (size_t) header.fileSize);
+    return false;
+  }
+
+  bool tiling = header.numFeatures == 0 || // unknown (e.g. compacted file)
+                (header.tilingsPerGroup == tilingsPerGroup &&
+                 header.numFeatures == HierarchicalFSM::num_features);
+  for (int i = 0; tiling && i < header.numFeatures; ++i) {
+    tiling = header.tileWidths[i] == tileWidths[i];
+  }
+  if (!tiling) {
+    cerr << "warning: tiling parameters of weight file " << filename
+         << " differ from those in use" << endl;
+  }
+
+  // copied into zero filled weights (unless used in place), leaving pages
+  // of untouched weights alone
+  const char *src = file + header.weightsOffset;
+  if (!mappedWeights) {
+    Precision prec = (Precision) header.precision;
+    if (prec == precision && header.offset == weights.getOffset()) {
+      static const char zeros[MappedWeightsHeader::ALIGNMENT] = {};
+      const long page = MappedWeightsHeader::ALIGNMENT;
+      long n = (long) memorySize * prec;
+      for (long i = 0; i < n; i += page) {
+        long m = min(page, n - i);
+        if (memcmp(src + i, zeros, (size_t) m) != 0)
+          memcpy((char *) weights.raw() + i, src + i, (size_t) m);
+      }
+    } else { // converted (quantized weights are dequantized)
+      RealArray from;
+      from.attach((void *) src, prec, header.scale, header.offset);
+      for (int i = 0; i < memorySize; ++i) {
+        double v = from[i];
+        if (v != weights.getOffset()) weights.set(i, v);
+      }
+    }
+  }
+
+  header.restoreColTab(file, *colTab);
+  munmap((void *) file, (size_t) header.fileSize);
+  cerr << "...done" << endl;
+  return true;
+}
+
+/**
+ * write to a temporary file renamed over filename when complete, so that
+ * processes mapping the old file keep a consistent view
+ * @param filename
+ * @return
+ */
+bool LinearSarsaLearner::saveMappedWeights(const char *filename) {
+  return writeMappedWeights(filename, weights.raw(), memorySize, precision,
+                            HierarchicalFSM::num_features, tileWidths, colTab,
+                            1.0, weights.getOffset());
+}
+
+/**
+ * write weights and collision table in the uncompressed (mapped) format
+ * @param filename
+ * @param weights
+ * @param memorySize
+ * @param precision
+ * @param numFeatures 0 if tiling parameters are unknown
+ * @param widths tile widths of features
+ * @param colTab
+ * @param scale of int16 weights
+ * @param offset weights are stored relative to
+ * @return
+ */
+bool LinearSarsaLearner::writeMappedWeights(
+    const char *filename, const void *weights, int memorySize,
+    Precision precision, int numFeatures, const double widths[],
+    collision_table *colTab, double scale, double offset) {
+  MappedWeightsHeader header;
+  header.setup(memorySize, precision, numFeatures,
+               numFeatures ? tilingsPerGroup : 0, widths, *colTab);
+  header.scale = scale;
+  header.offset = offset;
+
+  string tmp = string(filename) + ".tmp";
+  ofstream os(tmp.c_str(), ios::binary | ios::trunc);
+  if (!os.good()) {
+    cerr << "failed to open weight file: " << tmp << endl;
+    return false;
+  }
+
+  auto pad = [&os](long offset) { // zeros up to offset
+    static const char zeros[MappedWeightsHeader::ALIGNMENT] = {};
+    os.write(zeros, offset - (long) os.tellp());
+  };
+
+  os.write((char *) &header, sizeof(MappedWeightsHeader));
+  pad(header.weightsOffset);
+  os.write((const char *) weights, (long) memorySize * precision);
+  pad(header.colTabOffset);
+  os.write((char *) colTab->data(), (long) colTab->size * sizeof(int));
+  pad(header.fileSize);
   os.close();
+
+  if (os.fail() || rename(tmp.c_str(), filename) == -1) {
+    cerr << "failed to save weight file: " << filename << endl;
+    unlink(tmp.c_str());
+    return false;
+  }
   return true;
 }
 }
@@ -11,71 +11,368 @@
 #include <unordered_map>
 #include "tiles2.h"
 #include "HierarchicalFSM.h"
+#include "MachineStateTable.h"
+#include "TransitionLog.h"
+#include "EventLog.h"
+#include "Rng.h"
 #include <cstddef>
 #include <functional>
 
-namespace std {
-
-template<class T>
-struct hash<vector<T>> {
-  size_t operator()(const vector<T> &vec) const {
-    size_t seed = vec.size();
-    for (auto &i : vec) {
-      seed ^= hash<T>().operator()(i) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-    }
-    return seed;
-  }
-};
-
-}
-
 namespace fsm {
 
-typedef vector<string> machine_state_t;
 typedef vector<int> num_choice_t;
 typedef vector<int> choice_t;
 typedef unordered_map<machine_state_t, \
     unordered_map<int, \
         unordered_map<machine_state_t, double>>> transition_t;
 
+/**
+ * storage type of weights and traces (value is the size of one element)
+ */
+enum Precision : int {
+  PRECISION_INT16 = 2, // quantized weights of exported policies (inference)
+  PRECISION_FLOAT = 4,
+  PRECISION_DOUBLE = 8
+};
+
+/**
+ * view over an array of reals stored relative to offset in either single or
+ * double precision, or quantized to int16 as offset + scale * q; reals equal
+ * to offset are stored as zeros, so that zero filled (untouched) memory reads
+ * as offset
+ */
+class RealArray {
+public:
+  RealArray() : data(0), precision(PRECISION_DOUBLE), scale(1.0), offset(0.0) {}
+
+  void attach(void *p, Precision prec, double scale_ = 1.0,
+              double offset_ = 0.0) {
+    data = p;
+    precision = prec;
+    scale = scale_;
+    offset = offset_;
+  }
+
+  double operator[](int i) const {
+    if (precision == PRECISION_INT16) return offset + scale * ((short *) data)[i];
+    return offset + (precision == PRECISION_FLOAT ? ((float *) data)[i]
+                                                  : ((double *) data)[i]);
+  }
+
+  void set(int i, double v) {
+    if (precision == PRECISION_INT16) ((short *) data)[i] = quantize(v);
+    else if (precision == PRECISION_FLOAT) ((float *) data)[i] = (float) (v - offset);
+    else ((double *) data)[i] = v - offset;
+  }
+
+  void add(int i, double v) {
+    if (precision == PRECISION_INT16) set(i, (*this)[i] + v);
+    else if (precision == PRECISION_FLOAT) ((float *) data)[i] += (float) v;
+    else ((double *) data)[i] += v;
+  }
+
+  void fill(int n, double v) {
+    if (precision == PRECISION_INT16) std::fill((short *) data, (short *) data + n, quantize(v));
+    else if (precision == PRECISION_FLOAT) std::fill((float *) data, (float *) data + n, (float) (v - offset));
+    else std::fill((double *) data, (double *) data + n, v - offset);
+  }
+
+  // nearest int16 of v (saturated)
+  short quantize(double v) const {
+    double q = std::round((v - offset) / scale);
+    return (short) std::max(-32767.0, std::min(32767.0, q));
+  }
+
+  void *raw() const { return data; }
+
+  Precision getPrecision() const { return precision; }
+
+  double getScale() const { return scale; }
+
+  double getOffset() const { return offset; }
+
+private:
+  void *data;
+  Precision precision;
+  double scale; // of int16 reals
+  double offset;
+};
+
+/**
+ * scratch rows of tile indices of a learner, one row per valid choice; rows
+ * are as long as the number of tilings and are only reallocated when a larger
+ * set of choices is first seen, so that steps do not allocate
+ */
+class TileArena {
+public:
+  TileArena() : stride(0), rows(0) {}
+
+  void reserve(int num_tilings, int num_choices) {
+    if (num_tilings <= stride && num_choices <= rows) return;
+    stride = std::max(stride, num_tilings);
+    rows = std::max(rows, num_choices);
+    data.assign((size_t) stride * rows, 0);
+  }
+
+  int *operator[](int choice) { return data.data() + (size_t) choice * stride; }
+
+  const int *operator[](int choice) const {
+    return data.data() + (size_t) choice * stride;
+  }
+
+  int getStride() const { return stride; }
+
+  int getRows() const { return rows; }
+
+private:
+  vector<int> data;
+  int stride;
+  int rows;
+};
+
+/**
+ * joint choices of the teammates given the number of choices of each, as
+ * mixed-radix integers 0..size()-1 (the choice of K0 is the most significant
+ * digit), so that they are enumerated and decoded without lookups
+ */
+class JointChoices {
+public:
+  explicit JointChoices(const num_choice_t &num_choices);
+
+  int size() const { return count; }
+
+  // choice of teammate i in joint choice c
+  int choice(int c, int i) const { return c / stride[i] % radix[i]; }
+
+  void decode(int c, choice_t &ret) const;
+
+  static const int *ids(); // 0..MAX_RL_ACTIONS-1
+
+private:
+  int numAgents;
+  int count;
+  int radix[11];
+  int stride[11];
+};
+
+/**
+ * header of weight files (collision table entries are 64-bit before version
+ * 2, and probed by double hashing; they hold check values plus one from
+ * version 3)
+ */
+struct WeightsHeader {
+  char magic[8];
+  int version;
+  int memorySize;
+  int precision;
+  int colTabProbing; // version 2
+
+  static const char *MAGIC;
+  static const int VERSION = 3;
+
+  void setup(int memory_size, Precision prec);
+
+  bool valid() const;
+};
+
+/**
+ * header of uncompressed weight files, which are mapped into memory instead
+ * of being read (read only and shared among processes when not learning);
+ * the weight and collision tables follow at the recorded offsets, aligned to
+ * pages; weights are stored relative to offset, and those of exported
+ * policies may be quantized to int16 (version 2);
+ * collision table entries are 64-bit before version 3, and probed by double
+ * hashing; they hold check values plus one from version 5
+ */
+struct MappedWeightsHeader {
+  char magic[8];
+  int version;
+  int memorySize;
+  int precision;
+  int numFeatures;
+  int tilingsPerGroup;
+  int colTabSize;
+  int colTabSafe;
+  int colTabProbing; // version 3
+  long colTabCalls;
+  long colTabClearhits;
+  long colTabCollisions;
+  long weightsOffset;
+  long colTabOffset;
+  long fileSize;
+  double tileWidths[MAX_RL_STATE_VARS];
+  double scale; // weight = offset + scale * q if quantized (version 2)
+  double offset; // weight = offset + w otherwise (version 4)
+
+  static const char *MAGIC;
+  static const int VERSION = 5;
+  static const long ALIGNMENT = 4096;
+
+  void setup(int memory_size, Precision prec, int num_features,
+             int tilings_per_group, const double widths[],
+             const collision_table &ct);
+
+  bool valid() const;
+
+  long colTabEntrySize() const { return version >= 3 ? sizeof(int) : sizeof(long); }
+
+  void restoreColTab(const char *file, collision_table &ct) const;
+};
+
+/**
+ * barriers among agents at choice points (see LinearSarsaLearner::step)
+ */
+enum BarrierId {
+  BARRIER_ENTER1,
+  BARRIER_EXIT1,
+  BARRIER_ENTER2,
+  BARRIER_EXIT2,
+  BARRIER_RESET,
+  BARRIER_COUNT
+};
+
+/**
+ * joint decision made by agent 0 (indexed by K0..Kn), published to its
+ * teammates as one record (see SharedData::publish)
+ */
+struct JointDecision {
+  unsigned round; // decisions published so far, this one included
+  int idx; // joint choice, or -1 (new episode)
+  int time;
+  int numChoices[11]; // decided on
+  int choice[11];
+  stack_id_t machineState[11];
+};
+
+/**
+ * choice point an agent published last, with the cycle it was reached at;
+ * read as one record by teammates deciding on their own (see
+ * SharedData::readChoicePoint)
+ */
+struct PublishedChoicePoint {
+  unsigned seq; // odd while written
+  int time;
+  int numChoices;
+  stack_id_t machineState;
+};
+
+/**
+ * pids of the processes attached to a shared segment, to tell a segment in
+ * use from one left behind by processes that died without detaching
+ */
+struct ProcessSet {
+  static const int MAX_PROCESSES = 128;
+
+  int pids[MAX_PROCESSES]; // 0 if free
+
+  void add(int pid);
+
+  void remove(int pid);
+
+  // processes still running
+  int alive() const;
+};
+
+/**
+ * data shared among processes; the weight, trace and collision tables follow
+ * this struct in the same segment at the recorded offsets (weights and
+ * collision table are in the WeightPool instead if pooled)
+ */
 struct SharedData {
   double Q[MAX_RL_ACTIONS];
-  int tiles[MAX_RL_ACTIONS][RL_MAX_NUM_TILINGS];
-  double weights[RL_MEMORY_SIZE];
-  double traces[RL_MEMORY_SIZE];
   int nonzeroTraces[RL_MAX_NONZERO_TRACES];
-  int nonzeroTracesInverse[RL_MEMORY_SIZE];
   collision_table colTab;
 
+  int memorySize;
+  Precision precision;
+  long weightsOffset; // -1 if weights are mapped from the weight file or pooled
+  long tracesOffset;
+  long nonzeroTracesInverseOffset;
+  long colTabOffset; // -1 if pooled
+  long dirtyOffset; // pages of weights and colTab changed since checkpoint
+
   int numTilings;
   double minimumTrace;
+  double traceScale; // traces are stored divided by traceScale
   int numNonzeroTraces;
 
   int numChoices[OBJECT_MAX_OBJECTS]; // indexed by object type
-  char machineState[OBJECT_MAX_OBJECTS][MAX_MSG];
+  stack_id_t machineState[OBJECT_MAX_OBJECTS];
+  PublishedChoicePoint choicePoints[OBJECT_MAX_OBJECTS]; // indexed by object type
+  long decisions; // decentralized (see LinearSarsaLearner::decide)
+  long staleChoicePoints; // decisions with a teammate not at the same cycle
 
-  int lastJointChoiceIdx;
-  int lastJointChoiceTime;
-  int lastJointChoice[11]; // indexed by K0..Kn
-  char lastMachineState[11][MAX_MSG];
+  // last joint decision under a seqlock: decisionSeq is odd while it is
+  // written, so that readers retry torn reads instead of waiting
+  unsigned decisionSeq;
+  JointDecision decision;
+  long decisionReads;
+  long tornReads; // retried
+  long staleDecisions; // not made on the choice point of the reader
+
+  StackDict stackDict; // names of stack ids (kept across resets)
+  Barrier barriers[BARRIER_COUNT]; // reset by the first process to attach
+  ProcessSet processes; // attached (changed under the setup lock)
+
+  void getNumChoices(num_choice_t &ret) const;
 
-  num_choice_t getNumChoices() const;
+  void getMachineState(machine_state_t &ret) const;
 
-  choice_t getLastJointChoice() const;
+  void publish(const JointDecision &d);
 
-  machine_state_t getMachineState() const;
+  void readDecision(JointDecision &ret);
 
-  machine_state_t getLastMachineState() const;
+  void publishChoicePoint(int object, int time, int num_choices,
+                          stack_id_t machine_state);
 
-  void reset();
+  void readChoicePoint(int object, PublishedChoicePoint &ret);
+
+  void reset(bool zeroed = false);
+
+  void layout(int memory_size, Precision prec, bool mapped_weights = false,
+              bool pooled = false);
+
+  void *at(long offset) { return (char *) this + offset; }
+
+  static long size(int memory_size, Precision prec,
+                   bool mapped_weights = false, bool pooled = false);
+};
+
+/**
+ * weight and collision tables shared by the learners of concurrent games
+ * (hogwild): weights are updated without locks, and collision table entries
+ * are claimed with compare-and-swap (see claim in tiles2.cc); the tables
+ * follow this struct in the same segment at the recorded offsets
+ */
+struct WeightPool {
+  collision_table colTab;
+
+  int memorySize;
+  Precision precision;
+  int generation; // times the pool was set up under its name
+  int creator; // pid
+  int attached; // learners attached (changed under the pool lock)
+  ProcessSet learners; // of attached learners
+  long weightsOffset;
+  long colTabOffset;
+
+  void layout(int memory_size, Precision prec, int generation_);
+
+  void *at(long offset) { return (char *) this + offset; }
+
+  static long size(int memory_size, Precision prec);
 };
 
 class HierarchicalFSM;
 
+class Checkpointer;
+
 /**
  * Linear SARSA agent learning to make choice conditioned on env and machine states
  */
 class LinearSarsaLearner {
+  friend class LearnerBench; // tools/keepaway_bench.cc
+
 private:
   LinearSarsaLearner();
 
@@ -90,18 +387,47 @@ public:
       double weight, bool qLearning,
       string loadWeightsFile,
       string saveWeightsFile,
-      string teamName);
+      string teamName,
+      int memorySize = RL_MEMORY_SIZE,
+      Precision precision = PRECISION_DOUBLE);
 
   void shutDown();
 
+  void setBarrierTimeout(int ms);
+
+  void setCheckpoints(int episodes, int seconds, int keep, int deltas = 0);
+
+  bool setTransitionLog(const string &filename);
+
+  bool setEventLog(const string &filename);
+
+  void setDecentralized(bool decentralized, unsigned seed = 0);
+
+  static void setInProcess(bool threads);
+
+  static void setWeightPool(const string &name);
+
+  static void setHugePages(bool huge);
+
+  static void setSeed(unsigned seed);
+
+  static bool pageStats(const void *p, long &pageSize, long &resident,
+                        long &huge);
+
   int step(int current_time, int num_choices);
 
   int step(int current_time);
 
   void endEpisode(int current_time);
 
+  void replay(const TransitionRecord &record);
+
+  int recordTiles(const TransitionRecord &record, TileArena &tiles);
+
   bool loadSharedData();
 
+  bool loadDecision(int current_time, int num_choices, unsigned round);
+
   void saveSharedData();
 
   // Load / Save weights from/to disk
@@ -109,13 +435,42 @@ public:
 
   bool saveWeights(const char *filename);
 
+  static bool peekWeights(const char *filename, WeightsHeader &header);
+
+  static bool peekMappedWeights(const char *filename,
+                                MappedWeightsHeader &header);
+
+  static bool readWeights(istream &is, RealArray &weights, int memorySize,
+                          collision_table *colTab);
+
+  static void writeWeights(ostream &os, const void *weights, int memorySize,
+                           Precision precision, collision_table *colTab,
+                           double offset = 0.0);
+
+  static bool writeMappedWeights(const char *filename, const void *weights,
+                                 int memorySize, Precision precision,
+                                 int numFeatures, const double widths[],
+                                 collision_table *colTab, double scale = 1.0,
+                                 double offset = 0.0);
+
+  static void readReals(istream &is, RealArray &weights, int offset, int n,
+                        Precision prec, bool sparse = false);
+
+  static void writeReals(ostream &os, const void *reals, int n, Precision prec,
+                         double offset);
+
+  static const char *mapWeights(const char *filename,
+                                MappedWeightsHeader &header);
+
 public:
   int lastJointChoiceIdx;
   int lastJointChoiceTime;
   choice_t lastJointChoice;
   machine_state_t machineState; // indexed by K0..Kn
   machine_state_t lastMachineState; // indexed by K0..Kn
+  int jointMachineState; // interned machineState
   num_choice_t numChoices;
+  JointDecision decision; // last read from sharedData
 
 private:
   bool bLearning;
@@ -126,7 +481,58 @@ private:
   string teamName;
 
 private:
-  unordered_map<string, Barrier *> barriers;
+  int barrierTimeout; // ms
+  static bool inProcess; // agents are threads sharing SharedData in process
+
+  SharedData *attachInProcess(const string &name, size_t bytes, bool &created);
+
+  static unsigned rngSeed; // of rng (0: time)
+  Rng rng; // exploration and tie breaking
+
+  static bool hugePages; // back shared data and weight pools by huge pages
+  static const char *pagesAdvice; // how huge pages were asked for
+
+  static void adviseHugePages(void *p, size_t bytes);
+
+  static void reportPages(const char *what, const void *p);
+
+  static string weightPool; // name of the pool to join (if any)
+  WeightPool *pool; // weights shared with concurrent games (if joined)
+  string poolMemory;
+  string poolLock; // FileLock of pool setup and attached
+
+  void attachWeightPool(const string &weightsFile,
+                        const vector<string> &checkpoints);
+
+  void detachWeightPool();
+
+  int checkpointEpisodes;
+  int checkpointSeconds;
+  int checkpointKeep;
+  int checkpointDeltas;
+  Checkpointer *checkpointer; // of agent 0 while learning
+
+  TransitionLog transitions; // recorded joint decisions (if open)
+  TransitionRecord transition;
+  int replayChoice; // recorded choice to take (replay), or -1
+
+  EventLog events; // learner events of this agent (if open)
+
+  bool decentralized; // inference without barriers (see decide)
+  unsigned tieSeed; // shared by the team
+  Rng tieRng; // tie breaking of the current decision
+  vector<double> localQ; // Q of this agent (decentralized)
+  collision_table frozenColTab; // read only view of the shared table
+
+  int decide(int current_time, int num_choices);
+
+  void record(int kind, int tau, int choice);
+
+  void wait(BarrierId b, int current_time);
+
+  bool loadMappedWeights(const char *filename);
+
+  bool saveMappedWeights(const char *filename);
 
   double gamma;
   double lambda;
@@ -134,42 +540,56 @@ private:
   double epsilon;
   double tileWidths[MAX_RL_STATE_VARS];
 
+  int memorySize;
+  Precision precision;
+
   double *Q;
-  int (*tiles_)[RL_MAX_NUM_TILINGS];
-  double *weights;
-  double *traces;
+  TileArena tiles_; // tiles of the current decision
+  TileArena valueTiles; // tiles of Value
+  RealArray weights;
+  RealArray traces;
   int *nonzeroTraces;
   int *nonzeroTracesInverse;
   collision_table *colTab;
+  const char *mappedWeights; // read only weight file mapping (if any)
 
   int numTilings;
   double minimumTrace;
+  double traceScale; // traces are stored divided by traceScale
   int numNonzeroTraces;
 
+  static constexpr double MIN_TRACE_SCALE = 1.0e-12; // before rescaling
+
+  double trace(int f) const { return traces[f] * traceScale; }
+
   int loadTiles(
       double state[],
-      const machine_state_t &machine_state,
+      int machine_state,
       const num_choice_t &num_choices,
-      int (*tiles)[RL_MAX_NUM_TILINGS]);
+      TileArena &tiles);
 
   int selectChoice(const num_choice_t &num_choices);
 
-  double computeQ(int choice, int (*tiles)[RL_MAX_NUM_TILINGS], int numTilings);
+  double computeQ(int choice, const TileArena &tiles, int numTilings);
 
   double QValue(double *state,
-                const machine_state_t &machine_state,
+                int machine_state,
                 int choice,
-                int (*tiles)[RL_MAX_NUM_TILINGS],
+                const TileArena &tiles,
                 int num_tilings);
 
-  double Value(double *state, const machine_state_t &machine_state);
+  double Value(double *state, int machine_state);
 
   int argmaxQ(const num_choice_t &num_choices);
 
   void updateWeights(double delta, int num_tilings);
 
+  void terminalUpdate(int current_time);
+
   void decayTraces(double decayRate);
 
+  void compactTraces();
+
   void clearTrace(int f);
 
   void clearExistentTrace(int f, int loc);
@@ -178,16 +598,10 @@ private:
 
   void increaseMinTrace();
 
-  const vector<int> &validChoices(const num_choice_t &num_choices);
-
-  vector<choice_t> validChoicesRaw(const num_choice_t &num_choices);
-
   double initialWeight;
   string sharedMemory;
 
-  unordered_map<num_choice_t, vector<int>> validChoicesMap;
-  unordered_map<num_choice_t, vector<choice_t>> jointChoicesMap;
-  unordered_map<machine_state_t, num_choice_t> numChoicesMap;
+  unordered_map<int, num_choice_t> numChoicesMap;
   unordered_map<size_t, transition_t> staticTransitions;
 
   double reward(double tau);
@@ -50,6 +50,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Logger.h"
 #include <cstring>
+#include <cstdint>    // needed for uint32_t
+#include <sstream>    // needed for ostringstream
+#include <chrono>     // needed for milliseconds
 
 #ifdef Solaris
 #include <varargs.h> // needed for va_list and va_start under Solaris
@@ -71,6 +74,7 @@ Logger Log;          /*!<Logger instantation that can be used by all classes */
    \param iMin minimal log level (default 0)
    \param iMax maximal log level (default 0) */
 Logger::Logger( ostream& o, int iMin, int iMax )
+  : m_ring( NULL ), m_bStop( false )
 {
 //  pthread_mutex_init( &mutex_stream, NULL );
   strcpy( m_strHeader, "" );
@@ -79,6 +83,13 @@ Logger::Logger( ostream& o, int iMin, int iMax )
   m_os = &o;
 }
 
+/*!This is the destructor of the Logger. It stops the writer thread (if any),
+   after it has written all buffered messages. */
+Logger::~Logger( )
+{
+  stopAsync();
+}
+
 /*!This method can be used to log information. Only when the specified
    level of the message is part of the set of logged levels the
    information is logged. This method receives a a normal string that
@@ -90,7 +101,11 @@ bool Logger::log( int iLevel, string str)
 {
   if( isInLogLevel( iLevel ) )
   {
-    *m_os << m_strHeader << str;
+    LogRing *ring = m_ring.load( memory_order_acquire );
+    if( ring != NULL )
+      ring->push( m_strHeader, str.c_str(), "" );
+    else
+      *m_os << m_strHeader << str;
     return true;
   }
 
@@ -112,16 +127,21 @@ bool Logger::log( int iLevel, const char *str, ... )
   if( isInLogLevel( iLevel ) )
   {
     logSignal(); // test whether there are no old strings left to log
+    char buf[MAX_LOG_LINE]; // own buffer, since threads may log concurrently
     va_list ap;
 #ifdef Solaris
     va_start( ap );
 #else
     va_start( ap, str );
 #endif
-    if( vsnprintf( m_buf, MAX_LOG_LINE-1, str, ap ) == -1 )
+    if( vsnprintf( buf, MAX_LOG_LINE-1, str, ap ) == -1 )
       cerr << "Logger::log, buffer is too small!\n" ;
     va_end(ap);
-    *m_os << m_strHeader << m_buf << endl;
+    LogRing *ring = m_ring.load( memory_order_acquire );
+    if( ring != NULL )
+      ring->push( m_strHeader, buf, "\n" );
+    else
+      *m_os << m_strHeader << buf << endl;
     return true;
   }
 
@@ -158,7 +178,15 @@ bool Logger::logWithTime( int iLevel, const char *str, ... )
     s.append( m_buf );
     s.copy( m_buf, string::npos );
     m_buf[s.length()] = '\0';
-    m_timing.printTimeDiffWithText( *m_os, m_buf );
+    LogRing *ring = m_ring.load( memory_order_acquire );
+    if( ring != NULL )
+    {
+      ostringstream os;
+      m_timing.printTimeDiffWithText( os, m_buf );
+      ring->push( os.str().c_str(), "", "" );
+    }
+    else
+      m_timing.printTimeDiffWithText( *m_os, m_buf );
 
     return true;
   }
@@ -213,7 +241,11 @@ bool Logger::logSignal( )
 {
   if( ! m_strSignal.empty() )
   {
-    *m_os << "\n" << m_strSignal ;
+    LogRing *ring = m_ring.load( memory_order_acquire );
+    if( ring != NULL )
+      ring->push( "\n", m_strSignal.c_str(), "" );
+    else
+      *m_os << "\n" << m_strSignal ;
     m_strSignal = "";
     return true;
   }
@@ -338,6 +370,168 @@ void Logger::showLogLevels( ostream &os )
     os << *itr << " " ;
   os << endl;
 }
+
+/*! This method lets a writer thread write all messages to the output stream,
+    such that logging threads only copy them into a buffer of iBytes (rounded
+    up to a power of 2). Messages that do not fit in the buffer, when the
+    writer falls behind, are dropped.
+    \param iBytes size of the buffer
+    \return bool indicating whether the writer was started */
+bool Logger::setAsync( size_t iBytes )
+{
+  if( m_ring.load( memory_order_acquire ) != NULL )
+    return false;
+  m_bStop.store( false );
+  m_ring.store( new LogRing( iBytes ), memory_order_release );
+  m_writer = thread( &Logger::write, this );
+  return true;
+}
+
+/*! This method stops the writer thread after it has written all buffered
+    messages, such that messages are written on the calling thread again.
+    Threads that log must be stopped first: the buffer is freed.
+    \return number of messages dropped by the buffer */
+unsigned long Logger::stopAsync( )
+{
+  LogRing *ring = m_ring.exchange( NULL, memory_order_acq_rel );
+  if( ring == NULL )
+    return 0;
+  m_bStop.store( true, memory_order_release );
+  m_writer.join();
+  unsigned long iDropped = ring->getDropped();
+  delete ring;
+  return iDropped;
+}
+
+/*! This method is run by the writer thread: it writes the messages in the
+    buffer to the output stream in batches (compressed by the stream, if it
+    is a ogzstream), until it is stopped and the buffer is empty. */
+void Logger::write( )
+{
+  LogRing *ring = m_ring.load( memory_order_acquire ); // set before
+  string str;
+  while( true )
+  {
+    bool bStop = m_bStop.load( memory_order_acquire );
+    str.clear();
+    if( ring->pop( str ) > 0 )
+    {
+      m_os->write( str.data(), str.size() );
+      m_os->flush();
+    }
+    else if( bStop )
+      break;
+    else
+      this_thread::sleep_for( chrono::milliseconds( 1 ) );
+  }
+}
+
+/*****************************************************************************/
+/*********************** CLASS LOGRING ***************************************/
+/*****************************************************************************/
+
+#define LOG_RECORD_PAD 0x80000000u /*!< flags a record padding the ring end */
+
+/*! This is the constructor of the LogRing: records are stored in a buffer of
+    iSize bytes, rounded up to a power of 2 (at least 64 kB, which holds the
+    longest log line).
+    \param iSize size of the buffer */
+LogRing::LogRing( size_t iSize )
+  : m_head( 0 ), m_tail( 0 ), m_iDropped( 0 )
+{
+  m_iSize = 1 << 16;
+  while( m_iSize < iSize )
+    m_iSize <<= 1;
+  m_buf = new char[m_iSize]();   // a zero length word marks uncommitted space
+}
+
+LogRing::~LogRing( )
+{
+  delete [] m_buf;
+}
+
+/*! This method appends the concatenation of three strings as one record,
+    unless it does not fit in the free space of the buffer.
+    \return bool indicating whether the record was appended (not dropped) */
+bool LogRing::push( const char *str1, const char *str2, const char *str3 )
+{
+  size_t l1 = strlen( str1 ), l2 = strlen( str2 ), l3 = strlen( str3 );
+  size_t iLen = l1 + l2 + l3;
+  if( iLen == 0 )                // nothing to write (and no length to commit)
+    return true;
+  size_t iNeed = sizeof( uint32_t ) + ((iLen + 3) & ~(size_t)3);
+  size_t iPad, iHead = m_head.load( memory_order_relaxed );
+
+  do
+  {
+    // records are contiguous: pad the end of the buffer when one does not fit
+    size_t iOffset = iHead & (m_iSize - 1);
+    iPad = iOffset + iNeed > m_iSize ? m_iSize - iOffset : 0;
+    if( iHead + iPad + iNeed - m_tail.load( memory_order_acquire ) > m_iSize )
+    {
+      m_iDropped.fetch_add( 1, memory_order_relaxed );
+      return false;
+    }
+  } while( !m_head.compare_exchange_weak( iHead, iHead + iPad + iNeed,
+                                          memory_order_relaxed ) );
+
+  if( iPad > 0 )
+  {
+    uint32_t *len = (uint32_t *) ( m_buf + (iHead & (m_iSize - 1)) );
+    __atomic_store_n( len, (uint32_t) iPad | LOG_RECORD_PAD, __ATOMIC_RELEASE );
+    iHead += iPad;
+  }
+
+  char *rec = m_buf + (iHead & (m_iSize - 1));
+  memcpy( rec + sizeof( uint32_t ), str1, l1 );
+  memcpy( rec + sizeof( uint32_t ) + l1, str2, l2 );
+  memcpy( rec + sizeof( uint32_t ) + l1 + l2, str3, l3 );
+  __atomic_store_n( (uint32_t *) rec, (uint32_t) iLen, __ATOMIC_RELEASE );
+  return true;
+}
+
+/*! This method appends the committed records to str (in order, up to the
+    first one still being written) and frees their space. Only one thread may
+    call this method.
+    \param str string the records are appended to
+    \return number of bytes freed */
+size_t LogRing::pop( string &str )
+{
+  size_t iTail = m_tail.load( memory_order_relaxed );
+  size_t iBegin = iTail;
+
+  while( true )
+  {
+    char *rec = m_buf + (iTail & (m_iSize - 1));
+    uint32_t iLen = __atomic_load_n( (uint32_t *) rec, __ATOMIC_ACQUIRE );
+    if( iLen == 0 )
+      break;
+
+    size_t iSize;
+    if( iLen & LOG_RECORD_PAD )
+      iSize = iLen & ~LOG_RECORD_PAD;
+    else
+    {
+      str.append( rec + sizeof( uint32_t ), iLen );
+      iSize = sizeof( uint32_t ) + ((iLen + 3) & ~(size_t)3);
+    }
+    memset( rec, 0, iSize );
+    iTail += iSize;
+    if( iTail - iBegin >= m_iSize / 2 ) // let producers reuse the space
+      break;
+  }
+
+  m_tail.store( iTail, memory_order_release );
+  return iTail - iBegin;
+}
+
+/*! This method returns the number of records dropped because the buffer
+    was full.
+    \return number of dropped records */
+unsigned long LogRing::getDropped( )
+{
+  return m_iDropped.load( memory_order_relaxed );
+}
 /*****************************************************************************/
 /********************** CLASS TIMING *****************************************/
 /*****************************************************************************/
@@ -55,6 +55,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>     // needed for string
 #include <iomanip>    // needed for setw
 #include <set>        // needed for set
+#include <atomic>     // needed for atomic (LogRing)
+#include <thread>     // needed for thread (asynchronous writer)
 #include "prettyprint.h"
 
 #ifdef WIN32
@@ -112,6 +114,34 @@ public:
 } ;
 
 
+/*****************************************************************************/
+/*********************** CLASS LOGRING ***************************************/
+/*****************************************************************************/
+
+/*!This class is a bounded, lock free ring of log lines with any number of
+   producers and one consumer. Producers reserve space for a record by
+   advancing the head and commit it by writing its length last; the consumer
+   copies committed records in order and clears them. When the consumer falls
+   behind, lines that do not fit are dropped and counted, so memory stays
+   bounded and producers never block. */
+class LogRing
+{
+  char           *m_buf;           /*!< records, each behind a length word   */
+  size_t          m_iSize;         /*!< size of m_buf (power of 2)           */
+  atomic<size_t>  m_head;          /*!< position reserved up to              */
+  atomic<size_t>  m_tail;          /*!< position consumed up to              */
+  atomic<unsigned long> m_iDropped;/*!< number of lines dropped              */
+
+public:
+  LogRing( size_t iSize );
+  ~LogRing( );
+
+  bool          push      ( const char *str1, const char *str2,
+                            const char *str3                               );
+  size_t        pop       ( string     &str                                );
+  unsigned long getDropped(                                                );
+};
+
 /*****************************************************************************/
 /**************************** LOGGER *****************************************/
 /*****************************************************************************/
@@ -128,7 +158,10 @@ public:
     reference to it using the line 'extern Logger Log;' and can then use
     this Logger with the Log.log( ... ) methods. Furthermore the Logger also
     contains a timer with makes it possible to print the time since the timer
-    has been restarted. */
+    has been restarted.
+    Messages are written on the calling thread, unless an asynchronous buffer
+    is set (setAsync): then they are appended to a LogRing that a writer
+    thread empties into the output stream in batches. */
 class Logger
 {
   Timing   m_timing;               /*!< timer to print timing information    */
@@ -139,9 +172,15 @@ class Logger
   char     m_strHeader[MAX_HEADER];/*!< header string printed before msg     */
   ostream* m_os;                   /*!< output stream to print messages to   */
   string   m_strSignal;            /*!< temporary string for other messages  */
+  atomic<LogRing*> m_ring;         /*!< buffer of the writer (asynchronous)  */
+  thread   m_writer;               /*!< thread writing the buffer to m_os    */
+  atomic<bool> m_bStop;            /*!< indicates the writer should stop     */
+
+  void     write            (                                             );
 
 public:
   Logger( ostream& os=cout, int iMinLogLevel=0, int iMaxLogLevel = 0);
+  ~Logger( );
 
   // different methods associated with logging messages
   bool     log              ( int         iLevel, string str              );
@@ -165,7 +204,29 @@ public:
   bool     setOutputStream  ( ostream&    os                              );
   ostream& getOutputStream  (                                             );
   void     showLogLevels    ( ostream&    os                              );
+
+  bool     setAsync         ( size_t      iBytes                          );
+  unsigned long stopAsync   (                                             );
 };
 
+extern Logger Log;           /*!< Logger used by all classes (in Logger.cc) */
+
+/*! Messages of a level above LOG_MAX_LEVEL are compiled out of the LOG
+    macros (Release builds define it as 100, which removes the level 101
+    debugging of the hierarchical FSM). */
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL 0x7fffffff
+#endif
+
+/*! This macro returns whether messages of level iLevel are logged. */
+#define LOG_ENABLED(iLevel) \
+  ((iLevel) <= LOG_MAX_LEVEL && Log.isInLogLevel(iLevel))
+
+/*! This macro logs a message like Log.log, but only evaluates its arguments
+    when the level is logged. */
+#define LOG(iLevel, ...) \
+  do { \
+  if (LOG_ENABLED(iLevel)) Log.log(iLevel, __VA_ARGS__); \
+  } while(0)
 
 #endif
@@ -421,7 +421,7 @@ ostream& LoggerDraw::getOutputStream()
 
 char* LoggerDraw::escape( const char* str )
 {
-  static char str2[ MAX_TEXT ];
+  static thread_local char str2[ MAX_TEXT ];
 
   if ( str == NULL )
     return NULL;
@@ -0,0 +1,213 @@
+#include "MachineStateTable.h"
+#include "Logger.h"
+#include "Geometry.h"
+#include <climits>
+#include <cstring>
+
+extern Logger Log;
+
+namespace fsm {
+
+/**
+ * FNV-1a, fixed so that ids do not depend on the standard library
+ */
+static uint64_t hashStr(const std::string &s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (auto c : s) {
+    h ^= (unsigned char) c;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+static stack_id_t hashStack(stack_id_t parent, uint64_t frame) {
+  uint64_t x = (parent + 0x9e3779b97f4a7c15ULL) * 0xbf58476d1ce4e5b9ULL ^ frame;
+  x ^= x >> 31;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 29;
+  return x == EMPTY_STACK ? 1 : x;
+}
+
+MachineStateTable::MachineStateTable() : dict(0) {}
+
+MachineStateTable &MachineStateTable::ins() {
+  static thread_local MachineStateTable table;
+  return table;
+}
+
+/**
+ * share stack names through dict (living in shared memory)
+ * @param d
+ */
+void MachineStateTable::attach(StackDict *d) {
+  dict = d;
+  for (auto &s : stacks) {
+    publish(s.first, s.second);
+  }
+}
+
+frame_id_t MachineStateTable::frame(const std::string &name) {
+  auto it = frameIds.find(name);
+  if (it != frameIds.end()) return it->second;
+
+  frame_id_t f = (frame_id_t) frames.size();
+  frames.push_back({name, hashStr(name)});
+  frameIds[name] = f;
+  return f;
+}
+
+/**
+ * frame of an action with (small) integer parameters
+ * @param parameters
+ * @return
+ */
+frame_id_t MachineStateTable::actionFrame(std::initializer_list<int> parameters) {
+  Assert(parameters.size() < 4);
+  uint64_t key = parameters.size();
+  for (auto p : parameters) {
+    Assert(p >= 0 && p < (1 << 16));
+    key = (key << 16) | (uint64_t) p;
+  }
+
+  auto it = actionFrames.find(key);
+  if (it != actionFrames.end()) return it->second;
+
+  std::vector<std::string> strs;
+  for (auto p : parameters) strs.push_back(std::to_string(p));
+  frame_id_t f = frame("!" + to_prettystring(strs));
+  actionFrames[key] = f;
+  return f;
+}
+
+const std::string &MachineStateTable::frameStr(frame_id_t f) const {
+  return frames[f].str;
+}
+
+stack_id_t MachineStateTable::push(stack_id_t parent, frame_id_t f) {
+  stack_id_t s = hashStack(parent, frames[f].hash);
+  if (!stacks.count(s)) {
+    auto &str = stacks[s];
+    str = this->str(parent) + frames[f].str + " ";
+    publish(s, str);
+  }
+  return s;
+}
+
+/**
+ * string of stack s; a stack not published yet (by another process) gets a
+ * placeholder, which is not cached so that its name is looked up again
+ * @param s
+ * @return
+ */
+const std::string &MachineStateTable::str(stack_id_t s) {
+  static const std::string empty;
+  if (s == EMPTY_STACK) return empty;
+
+  auto it = stacks.find(s);
+  if (it != stacks.end()) return it->second;
+
+  auto name = lookup(s); // pushed by another process
+  if (name) return stacks[s] = name;
+
+  char buf[32];
+  sprintf(buf, "#%016llx ", (unsigned long long) s);
+  LOG(101, "MachineStateTable::str unknown stack %s", buf);
+  return unknown = buf;
+}
+
+/**
+ * id of joint machine state m; while one of its stacks is not published yet,
+ * m keeps a placeholder id, whose entry is replaced once they are all named
+ * @param m
+ * @return
+ */
+int MachineStateTable::joint(const machine_state_t &m) {
+  auto it = jointIds.find(m);
+  if (it != jointIds.end()) return it->second;
+
+  bool known = true;
+  std::vector<std::string> strs;
+  for (auto s : m) {
+    auto &name = str(s);
+    known = known && &name != &unknown;
+    strs.push_back(name);
+  }
+
+  auto pending = pendingJoints.find(m);
+  if (!known && pending != pendingJoints.end()) return pending->second;
+
+  Joint j;
+  j.str = to_prettystring(strs);
+  j.hash = (int) (std::hash<std::string>()(j.str) % INT_MAX);
+  int id;
+  if (pending != pendingJoints.end()) { // all named now
+    id = pending->second;
+    joints[id] = j;
+    pendingJoints.erase(pending);
+  } else {
+    joints.push_back(j);
+    id = (int) joints.size() - 1;
+  }
+  if (known) jointIds[m] = id;
+  else pendingJoints[m] = id;
+  return id;
+}
+
+/**
+ * joint machine state known only by its hash (e.g. replayed from a log)
+ * @param hash
+ * @return
+ */
+int MachineStateTable::jointOfHash(int hash) {
+  auto it = hashJoints.find(hash);
+  if (it != hashJoints.end()) return it->second;
+
+  Joint j;
+  j.str = "#" + std::to_string(hash);
+  j.hash = hash;
+  joints.push_back(j);
+  return hashJoints[hash] = (int) joints.size() - 1;
+}
+
+int MachineStateTable::jointHash(int j) const { return joints[j].hash; }
+
+const std::string &MachineStateTable::jointStr(int j) const {
+  return joints[j].str;
+}
+
+void MachineStateTable::publish(stack_id_t s, const std::string &str) {
+  if (!dict || lookup(s)) return;
+
+  // teammates could not name the stack, and would tile code their joint
+  // machine states differently
+  if (str.length() >= StackDict::MAX_STACK_STR) {
+    std::cerr << "MachineStateTable: stack too long to share (at most "
+              << StackDict::MAX_STACK_STR - 1 << " characters): " << str
+              << std::endl;
+    exit(1);
+  }
+
+  int i = __atomic_fetch_add(&dict->size, 1, __ATOMIC_ACQ_REL);
+  if (i >= StackDict::CAPACITY) {
+    std::cerr << "MachineStateTable: stack dict is full (" << StackDict::CAPACITY
+              << " stacks)" << std::endl;
+    exit(1);
+  }
+
+  strcpy(dict->entries[i].str, str.c_str());
+  __atomic_store_n(&dict->entries[i].id, s, __ATOMIC_RELEASE);
+}
+
+const char *MachineStateTable::lookup(stack_id_t s) const {
+  if (!dict) return 0;
+
+  int n = __atomic_load_n(&dict->size, __ATOMIC_ACQUIRE);
+  if (n > StackDict::CAPACITY) n = StackDict::CAPACITY;
+  for (int i = 0; i < n; ++i) {
+    if (__atomic_load_n(&dict->entries[i].id, __ATOMIC_ACQUIRE) == s)
+      return dict->entries[i].str;
+  }
+  return 0;
+}
+
+}
@@ -0,0 +1,116 @@
+#ifndef KEEPAWAY_PLAYER_MACHINESTATETABLE_H
+#define KEEPAWAY_PLAYER_MACHINESTATETABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <initializer_list>
+#include <functional>
+
+namespace std {
+
+template<class T>
+struct hash<vector<T>> {
+  size_t operator()(const vector<T> &vec) const {
+    size_t seed = vec.size();
+    for (auto &i : vec) {
+      seed ^= hash<T>().operator()(i) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+
+}
+
+namespace fsm {
+
+typedef uint64_t stack_id_t; // call stack configuration (same in all processes)
+typedef int frame_id_t; // stack frame: machine, choice point, choice or action
+typedef std::vector<stack_id_t> machine_state_t; // indexed by K0..Kn
+
+const stack_id_t EMPTY_STACK = 0;
+
+/**
+ * names of stack configurations, shared among processes so that a stack
+ * pushed by one agent can be named by the others
+ */
+struct StackDict {
+  static const int CAPACITY = 1024;
+  static const int MAX_STACK_STR = 256;
+
+  struct Entry {
+    stack_id_t id; // EMPTY_STACK until str is written
+    char str[MAX_STACK_STR];
+  };
+
+  int size;
+  Entry entries[CAPACITY];
+};
+
+/**
+ * interning of stack frames, stack configurations and joint machine states
+ *
+ * A stack configuration is identified by a hash of its frames, so that its
+ * id is the same in all processes; its string (as built by pushing frame
+ * names separated by spaces) is only built the first time it is pushed.
+ * Joint machine states are numbered locally, and keep the hash of their
+ * string form, which tile coding depends on.
+ */
+class MachineStateTable {
+private:
+  MachineStateTable();
+
+public:
+  static MachineStateTable &ins();
+
+  void attach(StackDict *dict);
+
+  frame_id_t frame(const std::string &name);
+
+  frame_id_t actionFrame(std::initializer_list<int> parameters);
+
+  const std::string &frameStr(frame_id_t f) const;
+
+  stack_id_t push(stack_id_t parent, frame_id_t f);
+
+  const std::string &str(stack_id_t s);
+
+  int joint(const machine_state_t &m);
+
+  int jointOfHash(int hash);
+
+  int jointHash(int j) const;
+
+  const std::string &jointStr(int j) const;
+
+private:
+  struct Frame {
+    std::string str;
+    uint64_t hash;
+  };
+
+  struct Joint {
+    std::string str;
+    int hash;
+  };
+
+  void publish(stack_id_t s, const std::string &str);
+
+  const char *lookup(stack_id_t s) const;
+
+  std::vector<Frame> frames;
+  std::unordered_map<std::string, frame_id_t> frameIds;
+  std::unordered_map<uint64_t, frame_id_t> actionFrames;
+  std::unordered_map<stack_id_t, std::string> stacks;
+  std::unordered_map<machine_state_t, int> jointIds;
+  std::unordered_map<machine_state_t, int> pendingJoints; // stacks unnamed
+  std::unordered_map<int, int> hashJoints; // joints only known by hash
+  std::vector<Joint> joints;
+  std::string unknown; // placeholder of the last stack not published yet
+  StackDict *dict;
+};
+
+}
+
+#endif //KEEPAWAY_PLAYER_MACHINESTATETABLE_H
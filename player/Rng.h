@@ -0,0 +1,53 @@
+#ifndef KEEPAWAY_PLAYER_RNG_H
+#define KEEPAWAY_PLAYER_RNG_H
+
+#include <cstdint>
+
+namespace fsm {
+
+/**
+ * xoshiro256** pseudo random generator, seeded through splitmix64: small,
+ * fast and reproducible across platforms (unlike rand), with its state owned
+ * by its user instead of the C library
+ */
+class Rng {
+public:
+  explicit Rng(uint64_t seed_ = 0) { seed(seed_); }
+
+  void seed(uint64_t seed_) {
+    for (auto &x : s) {
+      seed_ += 0x9e3779b97f4a7c15ull;
+      uint64_t z = seed_;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+      x = z ^ (z >> 31);
+    }
+  }
+
+  uint64_t next() {
+    uint64_t ret = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return ret;
+  }
+
+  // uniform in [0, 1)
+  double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+  // uniform in [0, n) (n > 0)
+  int below(int n) { return (int) (((next() >> 32) * (uint64_t) n) >> 32); }
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  uint64_t s[4];
+};
+
+}
+
+#endif //KEEPAWAY_PLAYER_RNG_H
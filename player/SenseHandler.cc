@@ -121,6 +121,7 @@ SenseHandler::SenseHandler(Connection *c, WorldModel *wm, ServerSettings *ss,
   itv.it_interval.tv_usec = 0;
   itv.it_value.tv_sec = 0;
   itv.it_value.tv_usec = 0;
+  act = NULL;
 #endif
 
   //*met 8/16/05
@@ -128,20 +129,65 @@ SenseHandler::SenseHandler(Connection *c, WorldModel *wm, ServerSettings *ss,
   m_iSyncCounter = 0;
 }
 
-/*! This is the main routine of this class. It loops forever (till the thread
-    is destroyed) and receives and parses the incoming messages.   */
+#ifndef WIN32
+/*! This function is called by the own timer of a SenseHandler (see
+    setActHandler) and sends the commands of its ActHandler.
+    \param v pointer to an ActHandler class.*/
+static void timer_callback(union sigval v)
+{
+  Log.logFromSignal( 2, "timer callback!!" );
+  ((ActHandler *) v.sival_ptr)->sendCommands();
+}
+#endif
+
+/*! Destructor of the SenseHandler. Deletes the own timer (if any). */
+SenseHandler::~SenseHandler()
+{
+#ifndef WIN32
+  if (act != NULL)
+    timer_delete(timer);
+#endif
+}
+
+/*! This method makes the SenseHandler send the commands of ActHandler 'a'
+    using a timer of its own instead of the process-wide SIGALRM, so that
+    more than one agent can run in the same process.
+    \param a ActHandler whose commands are sent when the timer expires */
+void SenseHandler::setActHandler(ActHandler *a)
+{
+#ifndef WIN32
+  struct sigevent sev;
+  memset(&sev, 0, sizeof(sev));
+  sev.sigev_notify = SIGEV_THREAD;
+  sev.sigev_notify_function = timer_callback;
+  sev.sigev_value.sival_ptr = a;
+  if (timer_create(CLOCK_MONOTONIC, &sev, &timer) == -1) {
+    cerr << "(SenseHandler::setActHandler) timer_create: "
+         << strerror(errno) << endl;
+    return;
+  }
+  act = a;
+#endif
+}
+
+/*! This is the main routine of this class. It loops till the thread is
+    destroyed (or the connection fails) and receives and parses the incoming
+    messages.   */
 void SenseHandler::handleMessagesFromServer() {
-  static char strBuf[MAX_MSG];
+  char strBuf[MAX_MSG];
   strBuf[0] = '\0';
 
   int i = 0;
 
-  while (1) {
+  while (i != -1) {                                      // until error
     strBuf[0] = '\0';
-    if (i != -1)                                         // if no error
-      i = connection->receiveMessage(strBuf, MAX_MSG);  // get message
-    if (strBuf[0] != '\0')                               // if not empty
+    i = connection->receiveMessage(strBuf, MAX_MSG);    // get message
+    if (strBuf[0] != '\0') {                             // if not empty
+      fsm::TraceSpan span(&WM->trace, fsm::TRACE_SENSE_THREAD,
+                          fsm::TRACE_RECEIVE);
       analyzeMessage(strBuf);                           // parse message
+      span.setCycle(WM->getCurrentCycle());
+    }
   }
 }
 
@@ -187,7 +233,32 @@ void SenseHandler::setTimeSignal() {
                          sigalarmHandler, (DWORD)0, TIME_ONESHOT );
 #else
   itv.it_value.tv_usec = iTimeSignal;
-  setitimer(ITIMER_REAL, &itv, NULL);
+  if (act != NULL) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_nsec = iTimeSignal * 1000L;
+    timer_settime(timer, 0, &its, NULL);
+  } else
+    setitimer(ITIMER_REAL, &itv, NULL);
+#endif
+}
+
+/*! This method disarms the timer set by setTimeSignal, such that no more
+    commands are sent (and logged) once the agent stops. */
+void SenseHandler::stopTimer() {
+#ifdef WIN32
+  if (iTimer != NULL) timeKillEvent( iTimer );
+  iTimer = NULL;
+#else
+  if (act != NULL) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    timer_settime(timer, 0, &its, NULL);
+  } else {
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_REAL, &off, NULL);
+  }
 #endif
 }
 
@@ -964,8 +1035,8 @@ bool SenseHandler::synchronize() {
   if (SS->getSynchMode() == true)
     return true;
 
-  static Time timeSync = -1;
-  static bool bNeedSync = true;
+  static thread_local Time timeSync = -1;
+  static thread_local bool bNeedSync = true;
   char str[64];
 
   // if in normal play mode -> don't synchronize
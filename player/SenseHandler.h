@@ -49,6 +49,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "Connection.h"
 #include "WorldModel.h"
+#include "ActHandler.h"
 
 extern Logger Log; /*!< This is a reference to the Logger to write  info to */
 
@@ -89,6 +90,8 @@ class SenseHandler {
   UINT        timerRes;      /*!< timer resolution for the application       */
 #else
   struct      itimerval itv; /*!< timer used to set alarm to send action     */
+  ActHandler  *act;          /*!< ActHandler woken by own timer (or NULL)    */
+  timer_t     timer;         /*!< own timer used instead of SIGALRM          */
 #endif
 
   //*met 8/16/05
@@ -100,12 +103,17 @@ class SenseHandler {
 public:
   SenseHandler( Connection* c, WorldModel* wm, ServerSettings *ss,
                 PlayerSettings *ps );
+  ~SenseHandler( );
+
+  // use an own timer to call ActHandler (needed with agents as threads)
+  void    setActHandler                 ( ActHandler *a              );
 
   // start the loop to handle the messages from the server
   void    handleMessagesFromServer      (              );
 
   // methods to determine when the next action should be sent to the server.
   void    setTimeSignal                 (                            );
+  void    stopTimer                     (                            );
 
   // method to analyze incoming messages
   bool    analyzeMessage                ( char *strMsg               );
@@ -65,7 +65,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Logger.h"
 
 ostream &operator<<(ostream &out, const DribbleT value) {
-  static unordered_map<int, string> strings;
+  static thread_local unordered_map<int, string> strings;
 
   if (strings.size() == 0) {
 #define INSERT_ELEMENT(p) strings[p] = #p
@@ -80,7 +80,7 @@ ostream &operator<<(ostream &out, const DribbleT value) {
 }
 
 ostream &operator<<(ostream &out, const PassT value) {
-  static unordered_map<int, string> strings;
+  static thread_local unordered_map<int, string> strings;
 
   if (strings.size() == 0) {
 #define INSERT_ELEMENT(p) strings[p] = #p
@@ -94,7 +94,7 @@ ostream &operator<<(ostream &out, const PassT value) {
 }
 
 ostream& operator<<(ostream& out, const ObjectT value) {
-  static unordered_map<int, string> strings;
+  static thread_local unordered_map<int, string> strings;
 
   if (strings.size() == 0){
 #define INSERT_ELEMENT(p) strings[p] = #p
@@ -69,6 +69,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define RL_MEMORY_SIZE (2 << 20)
 #define RL_MAX_NONZERO_TRACES (2 << 15)
 #define RL_MAX_NUM_TILINGS (2 << 12)
+#define CHECKPOINT_DELTAS 9 // delta checkpoints between full ones
 
 inline std::string getexepath() {
   char result[PATH_MAX];
@@ -0,0 +1,188 @@
+#include "TransitionLog.h"
+#include "Logger.h"
+#include "Geometry.h"
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+extern Logger Log;
+
+namespace fsm {
+
+const char *TransitionLogHeader::MAGIC = "KWQ-TRN";
+
+void TransitionLogHeader::setup(int num_features, int num_teammates,
+                                int num_opponents, const std::string &team_name,
+                                const double widths[]) {
+  memset(this, 0, sizeof(TransitionLogHeader));
+  memcpy(magic, MAGIC, sizeof(magic));
+  version = VERSION;
+  numFeatures = num_features;
+  numTeammates = num_teammates;
+  numOpponents = num_opponents;
+  strncpy(teamName, team_name.c_str(), sizeof(teamName) - 1);
+  for (int i = 0; i < num_features; ++i) {
+    tileWidths[i] = widths[i];
+  }
+}
+
+bool TransitionLogHeader::valid() const {
+  return strncmp(magic, MAGIC, sizeof(magic)) == 0 &&
+         version > 0 && version <= VERSION &&
+         numFeatures > 0 && numFeatures <= MAX_RL_STATE_VARS &&
+         numTeammates > 0 && numTeammates <= 11;
+}
+
+bool TransitionLogHeader::compatible(const TransitionLogHeader &o) const {
+  return numFeatures == o.numFeatures && numTeammates == o.numTeammates &&
+         strncmp(teamName, o.teamName, sizeof(teamName)) == 0;
+}
+
+TransitionLog::TransitionLog() : fd(-1), in(0) {
+  memset(&header, 0, sizeof(header));
+}
+
+TransitionLog::~TransitionLog() { close(); }
+
+/**
+ * append to filename, which is created with header if it does not exist yet
+ * @param filename
+ * @param header_
+ * @return false if filename can not be written or is not compatible
+ */
+bool TransitionLog::openWrite(const std::string &filename,
+                              const TransitionLogHeader &header_) {
+  close();
+  header = header_;
+
+  fd = createWithHeader(filename, &header, sizeof(header));
+  if (fd == -1 && errno == EEXIST) { // shared with teammates, or appended to
+    TransitionLogHeader existing;
+    fd = open(filename.c_str(), O_RDWR | O_APPEND);
+    if (fd != -1 &&
+        (pread(fd, &existing, sizeof(existing), 0) != sizeof(existing) ||
+         !existing.valid() || !existing.compatible(header))) {
+      std::cerr << "incompatible transition log: " << filename << std::endl;
+      close();
+    }
+  }
+
+  if (fd == -1) {
+    std::cerr << "failed to open transition log: " << filename << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int createWithHeader(const std::string &filename, const void *header,
+                     size_t size) {
+  std::string temp = filename + ".XXXXXX";
+  int fd = mkstemp(&temp[0]);
+  if (fd == -1) return -1;
+
+  int error = 0;
+  if (fchmod(fd, 0664) == -1 || fcntl(fd, F_SETFL, O_APPEND) == -1) {
+    error = errno;
+  } else if (::write(fd, header, size) != (ssize_t) size) {
+    error = EIO;
+  } else if (link(temp.c_str(), filename.c_str()) == -1) {
+    error = errno; // EEXIST: created by a teammate meanwhile
+  }
+  unlink(temp.c_str());
+  if (error) {
+    ::close(fd);
+    errno = error;
+    return -1;
+  }
+  return fd;
+}
+
+bool TransitionLog::openRead(const std::string &filename) {
+  close();
+  in = fopen(filename.c_str(), "rb");
+  if (!in) {
+    std::cerr << "failed to open transition log: " << filename << std::endl;
+    return false;
+  }
+
+  if (fread(&header, sizeof(header), 1, in) != 1 || !header.valid()) {
+    std::cerr << "invalid transition log: " << filename << std::endl;
+    close();
+    return false;
+  }
+  return true;
+}
+
+void TransitionLog::close() {
+  if (fd != -1) ::close(fd);
+  if (in) fclose(in);
+  fd = -1;
+  in = 0;
+}
+
+/**
+ * record layout: kind, tau, machineState, choice (ints), then for decisions
+ * numChoices (a byte per teammate) and state (doubles)
+ * @param record
+ */
+void TransitionLog::write(const TransitionRecord &record) {
+  if (fd == -1) return;
+
+  buffer.clear();
+  auto put = [this](const void *p, size_t n) {
+    buffer.insert(buffer.end(), (const char *) p, (const char *) p + n);
+  };
+
+  put(&record.kind, sizeof(int));
+  put(&record.tau, sizeof(int));
+  put(&record.machineState, sizeof(int));
+  put(&record.choice, sizeof(int));
+  if (record.kind == TransitionRecord::STEP) {
+    Assert(record.numChoices.size() == (size_t) header.numTeammates);
+    Assert(record.state.size() == (size_t) header.numFeatures);
+    for (auto n : record.numChoices) {
+      Assert(n >= 0 && n < 256);
+      unsigned char c = (unsigned char) n;
+      put(&c, 1);
+    }
+    put(record.state.data(), record.state.size() * sizeof(double));
+  }
+
+  if (::write(fd, buffer.data(), buffer.size()) != (ssize_t) buffer.size()) {
+    LOG(101, "TransitionLog::write failed: %s", strerror(errno));
+  }
+}
+
+bool TransitionLog::read(TransitionRecord &record) {
+  if (!in) return false;
+
+  int fields[4];
+  if (fread(fields, sizeof(int), 4, in) != 4) return false;
+  record.kind = fields[0];
+  record.tau = fields[1];
+  record.machineState = fields[2];
+  record.choice = fields[3];
+
+  if (record.kind == TransitionRecord::STEP) {
+    unsigned char numChoices[11];
+    record.numChoices.resize((size_t) header.numTeammates);
+    record.state.resize((size_t) header.numFeatures);
+    if (fread(numChoices, 1, (size_t) header.numTeammates, in) !=
+            (size_t) header.numTeammates ||
+        fread(record.state.data(), sizeof(double), record.state.size(), in) !=
+            record.state.size())
+      return false;
+    for (int i = 0; i < header.numTeammates; ++i) {
+      record.numChoices[i] = numChoices[i];
+    }
+  } else if (record.kind != TransitionRecord::END) {
+    std::cerr << "invalid transition record kind " << record.kind << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef KEEPAWAY_PLAYER_TRANSITIONLOG_H
+#define KEEPAWAY_PLAYER_TRANSITIONLOG_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include "SoccerTypes.h"
+
+namespace fsm {
+
+/**
+ * header of transition logs
+ */
+struct TransitionLogHeader {
+  char magic[8];
+  int version;
+  int numFeatures;
+  int numTeammates;
+  int numOpponents;
+  char teamName[16];
+  double tileWidths[MAX_RL_STATE_VARS];
+
+  static const char *MAGIC;
+  static const int VERSION = 1;
+
+  void setup(int num_features, int num_teammates, int num_opponents,
+             const std::string &team_name, const double widths[]);
+
+  bool valid() const;
+
+  bool compatible(const TransitionLogHeader &o) const;
+};
+
+/**
+ * a joint decision (STEP) or the end of an episode (END), as seen by the
+ * learner: tau is the time since the previous decision of the episode (-1 if
+ * none), machineState the hash of the joint machine state tiles are coded
+ * with; numChoices and state are only recorded for decisions
+ */
+struct TransitionRecord {
+  enum Kind : int {
+    STEP = 1,
+    END = 2
+  };
+
+  int kind;
+  int tau;
+  int machineState;
+  int choice;
+  std::vector<int> numChoices;
+  std::vector<double> state;
+};
+
+/**
+ * binary log of the transitions of a team, appended to by whichever agent
+ * makes joint decisions (one record per write, so that processes sharing the
+ * file do not interleave records)
+ */
+class TransitionLog {
+public:
+  TransitionLog();
+
+  ~TransitionLog();
+
+  bool openWrite(const std::string &filename,
+                 const TransitionLogHeader &header);
+
+  bool openRead(const std::string &filename);
+
+  void close();
+
+  void write(const TransitionRecord &record);
+
+  bool read(TransitionRecord &record);
+
+  bool isOpen() const { return fd != -1 || in; }
+
+  const TransitionLogHeader &getHeader() const { return header; }
+
+private:
+  int fd; // writing
+  FILE *in; // reading
+  TransitionLogHeader header;
+  std::vector<char> buffer;
+};
+
+/**
+ * create filename for appending, with header written to a temporary file
+ * first and linked into place, so that teammates never read a partial header
+ * @return the descriptor, or -1 (errno is EEXIST if filename exists)
+ */
+int createWithHeader(const std::string &filename, const void *header,
+                     size_t size);
+
+}
+
+#endif //KEEPAWAY_PLAYER_TRANSITIONLOG_H
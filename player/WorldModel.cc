@@ -1090,7 +1090,7 @@ bool WorldModel::isKnownPlayer( ObjectT o )
     it cannot be determined which object type is the opponent goalkeeper. */
 ObjectT WorldModel::getOppGoalieType()
 {
-  static ObjectT objGoalieType = OBJECT_ILLEGAL;
+  static thread_local ObjectT objGoalieType = OBJECT_ILLEGAL;
 
   if( objGoalieType != OBJECT_ILLEGAL &&
       isConfidenceGood( objGoalieType ) &&
@@ -2225,7 +2225,7 @@ bool WorldModel::waitForNewInformation( )
 void WorldModel::logObjectInformation( int iLogLevel, ObjectT obj )
 {
 
-  static char   str[2048];
+  static thread_local char   str[2048];
   double dConf     = PS->getPlayerConfThr();
   sprintf( str, "(%4d,%3d) ", getCurrentTime().getTime(),
 	                            getCurrentTime().getTimeStopped() );
@@ -2308,7 +2308,7 @@ bool WorldModel::isFeatureRelevant( FeatureT type )
 {
   int  iIndex  = (int)type;
   bool bReturn = true;
-  static Time  timeKickedUsed = -1;
+  static thread_local Time  timeKickedUsed = -1;
 
 #if 0
   Log.log( 460, "check feature (%d,%d,%d) relevance now (%d,%d,%d)",
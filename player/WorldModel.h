@@ -59,6 +59,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Logger.h"         // needed for Log
 #include "LoggerDraw.h"         // needed for Log
 #include "Formations.h"     // needed for getStrategicPosition (prediction)
+#include "CycleTrace.h"     // needed for CycleTrace
 #include <list>
 
 #ifdef WIN32
@@ -264,6 +265,7 @@ public:
   int iNrHoles;                /*!< nr of holes recorded           */
   int iNrOpponentsSeen;        /*!< total nr of opponents seen     */
   int iNrTeammatesSeen;        /*!< total nr of teammates seen     */
+  fsm::CycleTrace trace;       /*!< latencies of sense-think-act   */
 
   // last received messages
   char strLastSeeMessage[MAX_MSG];  /*!< Last see message         */
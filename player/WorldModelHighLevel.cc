@@ -515,8 +515,8 @@ double WorldModel::getMaxTraveledDistance(ObjectT o) {
 
 
 void WorldModel::createInterceptFeatures() {
-  static int count = 0;
-  static Time timeLastCalled(0, 0);
+  static thread_local int count = 0;
+  static thread_local Time timeLastCalled(0, 0);
 
   if (timeLastCalled == getTimeLastSenseMessage())
     count++;
@@ -695,8 +695,8 @@ SoccerCommand WorldModel::predictCommandToInterceptBall(ObjectT obj,
 //  Stamina sta;
   double dMinOldIntercept = 100, dDistanceOfIntercept = 10.0;
   int iOldIntercept = UnknownIntValue;
-  static Time timeLastIntercepted(-1, 0);
-  static VecPosition posOldIntercept;
+  static thread_local Time timeLastIntercepted(-1, 0);
+  static thread_local VecPosition posOldIntercept;
 
   // didn't intercept ball in last two cycles -> reset old interception point
   if ((getCurrentTime() - timeLastIntercepted) > 2)
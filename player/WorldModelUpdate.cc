@@ -312,7 +312,7 @@ bool WorldModel::storePlayerMessage( int iPlayer, char *strMsg, int iCycle )
 /*! This method processes a communication message from a teammate. */
 bool WorldModel::processPlayerMessage( )
 {
-  static char strMessage[MAX_MSG];                      // location for message
+  static thread_local char strMessage[MAX_MSG];          // location for message
   strMessage[0] = '\0';
 
   char        *strMsg;
@@ -626,21 +626,25 @@ void WorldModel::processQueuedCommands( SoccerCommand commands[],
     \return bool to indicate whether update succeeded. */
 bool WorldModel::updateAll( )
 {
-  Log.log(101, "WorldModel::updateAll");
+  LOG(101, "WorldModel::updateAll");
+  if( fsm::CycleTrace::enabled )       // collect what the other threads traced
+    trace.drain();
+  fsm::TraceSpan span( &trace, fsm::TRACE_THINK_THREAD, fsm::TRACE_UPDATE,
+                       getCurrentCycle() );
 
-  static Timing timer;
+  static thread_local Timing timer;
   double dTimeSense = 0.0, dTimeSee = 0.0, dTimeComm=0.0, dTimeFastest = 0.0;
-  static struct tms times1, times2;
+  static thread_local struct tms times1, times2;
 
   bool        bReturn            = false, bUpdateAfterSee = false;
   bool        bUpdateAfterSense  = false, bDebug = false;
-  static Time timeLastHoleRecorded;
-  static Time timeBeginInterval;
-  static Time timePlayersCounted;
-  static int  iNrHolesLastTime   = 0;
-  static Time timeLastSenseUpdate;
-  static Time timeLastSeeUpdate;
-  static Time timeLastSayUpdate;
+  static thread_local Time timeLastHoleRecorded;
+  static thread_local Time timeBeginInterval;
+  static thread_local Time timePlayersCounted;
+  static thread_local int  iNrHolesLastTime   = 0;
+  static thread_local Time timeLastSenseUpdate;
+  static thread_local Time timeLastSeeUpdate;
+  static thread_local Time timeLastSayUpdate;
   if( bDebug )
   {
     timer.restartTime();
@@ -822,7 +826,7 @@ void  WorldModel::processLastSeeMessage( )
   AngDeg  angBodyFacingDir, angHeadFacingDir;
   Time    time = getTimeLastSeeMessage();
   bool    isGoalie, isTackling;
-  static char strTmp[MAX_MSG];
+  static thread_local char strTmp[MAX_MSG];
   strTmp[0] = '\0';
 
   char   *strMsg = strLastSeeMessage ;
@@ -1767,7 +1771,7 @@ int WorldModel::checkParticlesAgent( AngDeg angGlobalNeck  )
 void WorldModel::updateParticlesAgent( VecPosition vel, bool bAfterSense )
 {
   // used to denote last added velocity
-  static VecPosition prev_vel;
+  static thread_local VecPosition prev_vel;
 
   for( int i = 0; i < iNrParticlesAgent  ; i ++ )
   {
@@ -62,6 +62,8 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "Parse.h"
 #include "gzstream.h"
 #include <dlfcn.h>    // needed for extension loading.
+#include <signal.h>   // needed for SIGALRM
+#include <thread>
 
 extern Logger Log;     /*!< This is a reference to the normal Logger class   */
 
@@ -72,7 +74,6 @@ void printOptions();
     (<program name> -help) and uses these values to create the classes. After
     all the classes are linked, the mainLoop in the Player class is called. */
 int main(int argc, char *argv[]) {
-  pthread_t sense;
   ServerSettings ss;
   PlayerSettings cs;
 
@@ -102,6 +103,24 @@ int main(int argc, char *argv[]) {
   double alpha = 0.125;
   double initialWeight = 0.0;
   bool qLearning = false;
+  int memorySize = RL_MEMORY_SIZE;
+  bool singlePrecision = false;
+  int barrierTimeout = 1000;
+  int checkpointEpisodes = 0;
+  int checkpointSeconds = 0;
+  int checkpointKeep = 3;
+  int checkpointDeltas = CHECKPOINT_DELTAS;
+  string transitionLogFile;
+  string eventLogFile;
+  bool decentralized = false;
+  string weightPool;
+  bool hugePages = false;
+  unsigned seed = 0;
+  bool traceCycles = false;
+  int logBuffer = 0;
+  int iThreads = 0;
+  string strClientConf;
+  string strServerConf;
 
 #ifdef _Compress
   ogzstream os;
@@ -126,13 +145,49 @@ int main(int argc, char *argv[]) {
           printOptions();
           exit(0);
           break;
+        case 'b': // log buffer (MB) of an asynchronous log writer
+          str = &argv[i + 1][0];
+          logBuffer = Parse::parseFirstInt(&str);
+          break;
+        case 'B': // barrier timeout (ms)
+          str = &argv[i + 1][0];
+          barrierTimeout = Parse::parseFirstInt(&str);
+          break;
+        case 'E': // decentralized inference
+          str = &argv[i + 1][0];
+          decentralized = Parse::parseFirstInt(&str) == 1;
+          break;
+        case 'H': // weight pool shared with concurrent games
+          weightPool = argv[i + 1];
+          break;
+        case 'S': // seed of exploration and tie breaking (0: time)
+          str = &argv[i + 1][0];
+          seed = (unsigned) Parse::parseFirstInt(&str);
+          break;
+        case 'P': // huge pages
+          str = &argv[i + 1][0];
+          hugePages = Parse::parseFirstInt(&str) == 1;
+          break;
+        case 'Y': // trace cycle latencies
+          str = &argv[i + 1][0];
+          traceCycles = Parse::parseFirstInt(&str) == 1;
+          break;
+        case 'C': // checkpoint every int episodes
+          str = &argv[i + 1][0];
+          checkpointEpisodes = Parse::parseFirstInt(&str);
+          break;
         case 'c':                                   // clientconf file
           if (!cs.readValues(argv[i + 1], ":"))
             cerr << "Error in reading client file: " << argv[i + 1] << endl;
+          strClientConf = argv[i + 1];
           break;
         case 'd':
           str = &argv[i + 1][0];
           break;
+        case 'D': // checkpoint every int seconds
+          str = &argv[i + 1][0];
+          checkpointSeconds = Parse::parseFirstInt(&str);
+          break;
         case 'e': // enable learning 0/1
           str = &argv[i + 1][0];
           bLearn = Parse::parseFirstInt(&str) == 1;
@@ -140,6 +195,10 @@ int main(int argc, char *argv[]) {
         case 'f':
           saveWeightsFile = argv[i + 1];
           break;
+        case 'F': // single precision weights 0/1
+          str = &argv[i + 1][0];
+          singlePrecision = Parse::parseFirstInt(&str) == 1;
+          break;
         case 'g': // gamma
           str = &argv[i + 1][0];
           gamma = Parse::parseFirstDouble(&str);
@@ -168,6 +227,10 @@ int main(int argc, char *argv[]) {
           str = &argv[i + 1][0];
           iNumKeepers = Parse::parseFirstInt(&str);
           break;
+        case 'K': // number of checkpoints kept
+          str = &argv[i + 1][0];
+          checkpointKeep = Parse::parseFirstInt(&str);
+          break;
         case 'l':                                   // loglevel int[..int]
           str = &argv[i + 1][0];
           iMinLogLevel = Parse::parseFirstInt(&str);
@@ -192,10 +255,18 @@ int main(int argc, char *argv[]) {
           str = &argv[i + 1][0];
           alpha = Parse::parseFirstDouble(&str);
           break;
+        case 'M': // memory size (number of weights)
+          str = &argv[i + 1][0];
+          memorySize = Parse::parseFirstInt(&str);
+          break;
         case 'm':                                   // mode int
           str = &argv[i + 1][0];
           iMode = Parse::parseFirstInt(&str);
           break;
+        case 'N': // number of delta checkpoints between full ones
+          str = &argv[i + 1][0];
+          checkpointDeltas = Parse::parseFirstInt(&str);
+          break;
         case 'n':                                   // number in formation int
           str = &argv[i + 1][0];
           iNr = Parse::parseFirstInt(&str);
@@ -219,6 +290,12 @@ int main(int argc, char *argv[]) {
           str = &argv[i + 1][0];
           qLearning = Parse::parseFirstInt(&str) == 1;
           break;
+        case 'R': // record transitions to file
+          transitionLogFile = argv[i + 1];
+          break;
+        case 'V': // record learner events to file
+          eventLogFile = argv[i + 1];
+          break;
         case 'r':                                   // reconnect 1 0
           str = &argv[i + 1][0];
           iReconnect = Parse::parseFirstInt(&str);
@@ -226,6 +303,11 @@ int main(int argc, char *argv[]) {
         case 's':                                   // serverconf file
           if (!ss.readValues(argv[i + 1], ":"))
             cerr << "Error in reading server file: " << argv[i + 1] << endl;
+          strServerConf = argv[i + 1];
+          break;
+        case 'T': // number of agents run as threads (0: single agent)
+          str = &argv[i + 1][0];
+          iThreads = Parse::parseFirstInt(&str);
           break;
         case 't':                                   // teamname name
           strcpy(strTeamName, argv[i + 1]);
@@ -261,6 +343,19 @@ int main(int argc, char *argv[]) {
          "alpha : " << alpha << endl <<
          "initialWeight: " << initialWeight << endl <<
          "qlearning: " << qLearning << endl <<
+         "memory size: " << memorySize << endl <<
+         "single precision: " << singlePrecision << endl <<
+         "barrier timeout: " << barrierTimeout << endl <<
+         "checkpoints: " << checkpointEpisodes << " episodes, "
+         << checkpointSeconds << " seconds, " << checkpointKeep << " kept, "
+         << checkpointDeltas << " deltas" << endl <<
+         "decentralized: " << decentralized << endl <<
+         "weight pool: " << weightPool << endl <<
+         "huge pages: " << hugePages << endl <<
+         "seed: " << seed << endl <<
+         "trace cycles: " << traceCycles << endl <<
+         "log buffer: " << logBuffer << " MB" << endl <<
+         "threads: " << iThreads << endl <<
          "be learning : " << bLearn << endl;
   }
 
@@ -268,56 +363,124 @@ int main(int argc, char *argv[]) {
     Log.setOutputStream(os);                   // initialize logger
   else
     Log.setOutputStream(cout);
+  if (logBuffer > 0)
+    Log.setAsync((size_t) logBuffer << 20);
 
   Log.restartTimer();
 
-  WorldModel wm(&ss, &cs, NULL);              // create worldmodel
-  Connection c(strHost, iPort, MAX_MSG);     // make connection with server
-  ActHandler a(&c, &wm, &ss);                // link actHandler and worldmodel
-  SenseHandler s(&c, &wm, &ss, &cs);         // link senseHandler with wm
+  fsm::LinearSarsaLearner::setWeightPool(weightPool);
+  fsm::LinearSarsaLearner::setHugePages(hugePages);
+  fsm::LinearSarsaLearner::setSeed(seed);
+  fsm::CycleTrace::enabled = traceCycles;
 
-  double ranges[MAX_RL_STATE_VARS];
-  double minValues[MAX_RL_STATE_VARS];
-  double resolutions[MAX_RL_STATE_VARS];
+  // run an agent with its own world model, connection and handlers
+  auto runAgent = [&](ServerSettings &ss, PlayerSettings &cs,
+                      bool threads) -> int {
+    pthread_t sense;
+    WorldModel wm(&ss, &cs, NULL);              // create worldmodel
+    Connection c(strHost, iPort, MAX_MSG);     // make connection with server
+    ActHandler a(&c, &wm, &ss);                // link actHandler and worldmodel
+    SenseHandler s(&c, &wm, &ss, &cs);         // link senseHandler with wm
+    if (threads)
+      s.setActHandler(&a);                     // no process-wide SIGALRM
 
-  int numFeatures = 0;
-  if (string(strTeamName) == "keepers") {
-    numFeatures = wm.keeperStateRangesAndResolutions(ranges, minValues, resolutions,
-                                                     iNumKeepers, iNumTakers);
-  }
-  else {
-    numFeatures = wm.takerStateRangesAndResolutions(ranges, minValues, resolutions,
-                                                    iNumKeepers, iNumTakers);
-  }
+    double ranges[MAX_RL_STATE_VARS];
+    double minValues[MAX_RL_STATE_VARS];
+    double resolutions[MAX_RL_STATE_VARS];
 
-  if (!hierarchicalFSM) {
-    cerr << "No agent!" << endl;
-    return EXIT_FAILURE;
-  } else {
+    int numFeatures = 0;
     if (string(strTeamName) == "keepers") {
-      fsm::HierarchicalFSM::initialize(
-          numFeatures, iNumKeepers, iNumTakers, bLearn,
-          resolutions, gamma, lambda, alpha, initialWeight, qLearning,
-          loadWeightsFile, saveWeightsFile, strTeamName);
+      numFeatures = wm.keeperStateRangesAndResolutions(ranges, minValues, resolutions,
+                                                       iNumKeepers, iNumTakers);
     }
     else {
-      fsm::HierarchicalFSM::initialize(
-          numFeatures, iNumTakers, iNumKeepers, bLearn,
-          resolutions, gamma, lambda, alpha, initialWeight, qLearning,
-          loadWeightsFile, saveWeightsFile, strTeamName);
-    };
-  }
+      numFeatures = wm.takerStateRangesAndResolutions(ranges, minValues, resolutions,
+                                                      iNumKeepers, iNumTakers);
+    }
+
+    if (!hierarchicalFSM) {
+      cerr << "No agent!" << endl;
+      return EXIT_FAILURE;
+    } else {
+      if (string(strTeamName) == "keepers") {
+        fsm::HierarchicalFSM::initialize(
+            numFeatures, iNumKeepers, iNumTakers, bLearn,
+            resolutions, gamma, lambda, alpha, initialWeight, qLearning,
+            loadWeightsFile, saveWeightsFile, strTeamName, memorySize,
+            singlePrecision ? fsm::PRECISION_FLOAT : fsm::PRECISION_DOUBLE);
+      }
+      else {
+        fsm::HierarchicalFSM::initialize(
+            numFeatures, iNumTakers, iNumKeepers, bLearn,
+            resolutions, gamma, lambda, alpha, initialWeight, qLearning,
+            loadWeightsFile, saveWeightsFile, strTeamName, memorySize,
+            singlePrecision ? fsm::PRECISION_FLOAT : fsm::PRECISION_DOUBLE);
+      };
+      fsm::LinearSarsaLearner::ins().setBarrierTimeout(barrierTimeout);
+      fsm::LinearSarsaLearner::ins().setCheckpoints(
+          checkpointEpisodes, checkpointSeconds, checkpointKeep,
+          checkpointDeltas);
+      if (!transitionLogFile.empty())
+        fsm::LinearSarsaLearner::ins().setTransitionLog(transitionLogFile);
+      if (!eventLogFile.empty())
+        fsm::LinearSarsaLearner::ins().setEventLog(eventLogFile);
+      if (decentralized)
+        fsm::LinearSarsaLearner::ins().setDecentralized(true, seed);
+    }
+
+    KeepawayPlayer bp(&a, &wm, &ss, &cs, strTeamName,
+                      iNumKeepers, iNumTakers, dVersion, iReconnect);
 
-  KeepawayPlayer bp(&a, &wm, &ss, &cs, strTeamName,
-                    iNumKeepers, iNumTakers, dVersion, iReconnect);
+    pthread_create(&sense, NULL, sense_callback, &s); // start listening
 
-  pthread_create(&sense, NULL, sense_callback, &s); // start listening
+    if (iMode == 0)
+      bp.mainLoop();
 
-  if (iMode == 0)
-    bp.mainLoop();
+    // stop listening and sending before the handlers (and the log buffer)
+    // go away
+    pthread_cancel(sense);
+    pthread_join(sense, NULL);
+    s.stopTimer();
+    c.disconnect();
+    return EXIT_SUCCESS;
+  };
 
-  c.disconnect();
+  int ret = EXIT_SUCCESS;
+  if (iThreads > 0) { // all agents as threads of this process
+    fsm::LinearSarsaLearner::setInProcess(true);
+    vector<thread> agents;
+    vector<int> rets((unsigned long) iThreads, EXIT_SUCCESS);
+    for (int i = 0; i < iThreads; ++i) {
+      agents.push_back(thread([&, i]() {
+        // own settings, since they are updated by server messages
+        ServerSettings ssAgent;
+        PlayerSettings csAgent;
+        if (!strServerConf.empty())
+          ssAgent.readValues(strServerConf.c_str(), ":");
+        if (!strClientConf.empty())
+          csAgent.readValues(strClientConf.c_str(), ":");
+        rets[i] = runAgent(ssAgent, csAgent, true);
+      }));
+    }
+    for (int i = 0; i < iThreads; ++i) {
+      agents[i].join();
+      if (rets[i] != EXIT_SUCCESS) ret = rets[i];
+    }
+  } else {
+    ret = runAgent(ss, cs, false);
+  }
+
+#ifndef WIN32
+  sigset_t alarm; // an alarm still pending would send (and log) commands
+  sigemptyset(&alarm);
+  sigaddset(&alarm, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &alarm, NULL);
+#endif
+  unsigned long dropped = Log.stopAsync(); // write out before closing
+  if (dropped > 0)
+    cerr << "Log buffer full, " << dropped << " messages dropped" << endl;
   os.close();
+  return ret;
 }
 
 /*! This function prints the command prompt options that can be supplied to the
@@ -325,26 +488,42 @@ int main(int argc, char *argv[]) {
 void printOptions() {
   cout << "Command options:" << endl <<
        " a file                - write drawing log info to " << endl <<
+       " b(uffer) int          - write log info from a thread through int MB" << endl <<
+       " B(arrier) int         - barrier timeout in ms (0 for none)" << endl <<
        " c(lientconf) file     - use file as client conf file" << endl <<
+       " C(heckpoint) int      - checkpoint weights every int episodes" << endl <<
        " d(rawloglevel) int[..int] - level(s) of drawing debug info" << endl <<
+       " D(uration) int        - checkpoint weights every int seconds" << endl <<
        " e(nable) learning 0/1  - turn learning on/off" << endl <<
+       " E 0/1                 - decentralized inference (no barriers) when not learning" << endl <<
        " f save weights file   - use file to save weights" << endl <<
+       " F(loat) 0/1           - store weights and traces in single precision" << endl <<
        " h(ost) hostname       - host to connect with" << endl <<
+       " H name                - share weights with concurrent games learning into pool name" << endl <<
        " he(lp)                - print this information" << endl <<
        " hi(ve) 0/1            - use mmap to hive mind the team" << endl <<
        " i(nfo) 0/1            - print variables used to start" << endl <<
        " j takers  int         - number of takers" << endl <<
        " k(eepers) int         - number of keepers" << endl <<
+       " K(eep) int            - number of checkpoints kept" << endl <<
        " l(oglevel) int[..int] - level of debug info" << endl <<
        " m(ode) int            - which mode to start up with" << endl <<
+       " M(emory) int          - number of weights (power of 2)" << endl <<
        " n(umber) int          - player number in formation" << endl <<
+       " N int                 - delta checkpoints between full ones" << endl <<
        " o(utput) file         - write log info to (screen is default)" << endl <<
        " p(ort)                - port number to connect with" << endl <<
+       " P 0/1                 - back shared data by huge pages (2 MB)" << endl <<
        " q policy name         - policy to play with" << endl <<
        " r(econnect) int       - reconnect as player nr" << endl <<
+       " R(ecord) file         - record transitions to file" << endl <<
        " s(erverconf) file     - use file as server conf file" << endl <<
+       " S(eed) int            - seed of exploration and tie breaking (0: time)" << endl <<
        " t(eamname) name       - name of your team" << endl <<
+       " T(hreads) int         - run int agents as threads of one process" << endl <<
+       " V file                - record learner events to file (see kwlogdump)" << endl <<
        " w(eights) file        - use file to load weights" << endl <<
        " x exit after running for this many episodes" << endl <<
+       " Y 0/1                 - trace cycle latencies, reported at exit" << endl <<
        " y enable learning after not learning for this many episodes" << endl;
 }
@@ -17,12 +17,12 @@ across integer values.
 
 It is recommended by the UNH folks that num-tilings be a power of 2, e.g., 16.
 
-We assume the existence of a function "rand()" that produces successive
-random integers, of which we use only the low-order bytes.
+Hashing uses a fixed table of random integers (see hash_table).
 */
 
 #include <iostream>
 #include <climits>
+#include <cstring>
 #include "tiles2.h"
 #include "Logger.h"
 
@@ -114,107 +114,652 @@ void GetTiles(
 }
 
 
-/* hash_UNH
-   Takes an array of integers and returns the corresponding tile after hashing
+/* hash_table
+   Returns the table of random numbers used by hashing: the bytes rand() gave
+   after srand(0) (glibc), as the table used to be built at run time, so that
+   hashed tiles (and saved weights) stay the same in every process
 */
+static constexpr unsigned int rndseq[2048] = {
+    0x67c66973, 0x51ff4aec, 0x29cdbaab, 0xf2fbe346, 0x7cc254f8, 0x1be8e78d,
+    0x765a2e63, 0x339fc99a, 0x66320db7, 0x3158a35a, 0x255d0517, 0x58e95ed4,
+    0xabb2cdc6, 0x9bb45411, 0x0e827441, 0x213ddc87, 0x70e93ea1, 0x41e1fc67,
+    0x3e017e97, 0xeadc6b96, 0x8f385c2a, 0xecb03bfb, 0x32af3c54, 0xec18db5c,
+    0x021afe43, 0xfbfaaa3a, 0xfb29d1e6, 0x053c7c94, 0x75d8be61, 0x89f95cbb,
+    0xa8990f95, 0xb1ebf1b3, 0x05eff700, 0xe9a13ae5, 0xca0bcbd0, 0x484764bd,
+    0x1f231ea8, 0x1c7b64c5, 0x14735ac5, 0x5e4b7963, 0x3b706424, 0x119e09dc,
+    0xaad4acf2, 0x1b10af3b, 0x33cde350, 0x4847155c, 0xbb6f2219, 0xba9b7df5,
+    0x0be11a1c, 0x7f23f829, 0xf8a41b13, 0xb5ca4ee8, 0x983238e0, 0x794d3d34,
+    0xbc5f4e77, 0xfacb6c05, 0xac86212b, 0xaa1a55a2, 0xbe70b573, 0x3b045cd3,
+    0x3694b3af, 0xe2f0e49e, 0x4f321549, 0xfd824ea9, 0x0870d4b2, 0x8a295448,
+    0x9a0abcd5, 0x0e18a844, 0xac5bf38e, 0x4cd72d9b, 0x0942e506, 0xc433afcd,
+    0xa3847f2d, 0xadd47647, 0xde321cec, 0x4ac430f6, 0x2023856c, 0xfbb20704,
+    0xf4ec0bb9, 0x20ba86c3, 0x3e05f1ec, 0xd96733b7, 0x9950a3e3, 0x14d3d934,
+    0xf75ea0f2, 0x10a8f605, 0x9401beb4, 0xbc4478fa, 0x4969e623, 0xd01ada69,
+    0x6a7e4c7e, 0x5125b348, 0x84533a94, 0xfb319990, 0x325744ee, 0x9bbce9e5,
+    0x25cf08f5, 0xe9e25e53, 0x60aad2b2, 0xd085fa54, 0xd835e8d4, 0x66826498,
+    0xd9a88775, 0x65705a8a, 0x3f628029, 0x44de7ca5, 0x894e5759, 0xd351adac,
+    0x869580ec, 0x17e485f1, 0x8c0c66f1, 0x7cc07cbb, 0x22fce466, 0xda610b63,
+    0xaf62bc83, 0xb4692f3a, 0xffaf2716, 0x93ac071f, 0xb86d1134, 0x2d8def4f,
+    0x89d4b663, 0x35c1c7e4, 0x248367d8, 0xed9612ec, 0x453902d8, 0xe50af89d,
+    0x7709d1a5, 0x96c1f41f, 0x95aa82ca, 0x6c49ae90, 0xcd1668ba, 0xac7aa6f2,
+    0xb4a8ca99, 0xb2c2372a, 0xcb08cf61, 0xc9c3805e, 0x6e0328da, 0x4cd76a19,
+    0xedd2d399, 0x4c798b00, 0x22569ad4, 0x18d1fee4, 0xd9cd45a3, 0x91c601ff,
+    0xc92ad915, 0x01432fee, 0x15028761, 0x7c13629e, 0x69fc7281, 0xcd7165a6,
+    0x3eab49cf, 0x714bce3a, 0x75a74f76, 0xea7e64ff, 0x81eb61fd, 0xfec39b67,
+    0xbf0de98c, 0x7e4e32bd, 0xf97c8c6a, 0xc75ba43c, 0x02f4b2ed, 0x7216ecf3,
+    0x014df000, 0x108b67cf, 0x99505b17, 0x9f8ed498, 0x0a6103d1, 0xbca70dbe,
+    0x9bbfab0e, 0xd59801d6, 0xe5f2d6f6, 0x7d3ec516, 0x8e212e2d, 0xaf02c6b9,
+    0x63c98a1f, 0x7097de0c, 0x56891a2b, 0x211b0107, 0x0dd8fd8b, 0x16c2a1a4,
+    0xe3cfd292, 0xd2984b35, 0x61d555d1, 0x6c33ddc2, 0xbcf7edde, 0x13efe520,
+    0xc7e2abdd, 0xa44d8188, 0x1c531aee, 0xeb66244c, 0x3b791ea8, 0xacfb6a68,
+    0xf3584606, 0x472b260e, 0x0dd2ebb2, 0x1f6c3a3b, 0xc0542aab, 0xba4ef8f6,
+    0xc7169e73, 0x1108db04, 0x60220aa7, 0x4d31b55b, 0x03a00d22, 0x0d475dcd,
+    0x9b877856, 0xd5704c9c, 0x86ea0f98, 0xf2eb9c53, 0x0da7fa5a, 0xd8b0b5db,
+    0x50c2fd5d, 0x095a2aa5, 0xe2a3fbb7, 0x1347549a, 0x31633223, 0x4ece765b,
+    0x7571b64d, 0x216b2871, 0x2e25cf37, 0x80f9dc62, 0x9cd719b0, 0x1e6d4a4f,
+    0xd17c731f, 0x4ae97bc0, 0x5a310d7b, 0x9c36edca, 0x5bbc02db, 0xb5de3d52,
+    0xb65702d4, 0xc44c2495, 0xc897b512, 0x8030d2db, 0x61e056fd, 0x1643c871,
+    0xffca4db5, 0xa88a075e, 0xe10933a6, 0x55573b1d, 0xeef02f6e, 0x20024981,
+    0xe2a07ff8, 0xe34769e3, 0x11b698b9, 0x419f1822, 0xa84bc8fd, 0xa2041a90,
+    0xf449fe15, 0x4b48962d, 0xe81525cb, 0x5c8fae6d, 0x45462786, 0xe53fa98d,
+    0x8a718a2c, 0x75a4bc6a, 0xeeba7f39, 0x021567ea, 0x2b8cb687, 0x1b64f561,
+    0xab1ce790, 0x5b901ee5, 0x02a81177, 0x4dcde13b, 0x8760748a, 0x76db74a1,
+    0x682a2883, 0x8f1de43a, 0x39ccca94, 0x5ce8795e, 0x918ad6de, 0x57b719df,
+    0x188d698e, 0x69dd2fd1, 0x08575497, 0x7539d1ae, 0x059b4361, 0x84bcc015,
+    0x4796f39e, 0x4d0c7d65, 0x99e6f302, 0xc422d3cc, 0x7a2863ef, 0x61349d66,
+    0xcfe0c753, 0x9d8768e4, 0x1d5b826b, 0x6700d001, 0xe6c403aa, 0xe6d77660,
+    0xffd94f60, 0x0dedc6dd, 0xcd8d306a, 0x15994e32, 0xf4d19d5c, 0xd16e5db7,
+    0x32606218, 0x37d87936, 0xb2c896bf, 0xb55c9c83, 0xeacdedff, 0x663c315a,
+    0x0dcfb6de, 0x3d13956f, 0x74f787ab, 0xd000e282, 0xc978417e, 0xd5de01bf,
+    0xabefbe11, 0x2bef6b38, 0xbe2216fb, 0x35ab6aa9, 0xa3f25573, 0xf237f5bb,
+    0xaf363a84, 0x143b43bf, 0x2a01d055, 0xf13c8daf, 0x5ea3ab93, 0x4f153df2,
+    0x079265fa, 0xc95ab578, 0x90effda5, 0x2b406455, 0x4235ab33, 0x7138e2cf,
+    0xdc8d622b, 0xa39f1daa, 0x3182a4fa, 0xdc5a736c, 0x49701174, 0xb076caf2,
+    0xab75251c, 0xad08eb89, 0x954db438, 0xedd1e31e, 0x5387192f, 0xe18c9c2b,
+    0xfcad9fac, 0x23699fce, 0xdec4ea8c, 0xccd51562, 0x23ca9a10, 0x9b7d2eef,
+    0x05471ee6, 0xd3ba11cf, 0x68b17c8b, 0x1a1b5af9, 0xdf4485ac, 0x1a9a0e3d,
+    0x64a84d00, 0x267bef2b, 0xc30d1196, 0xc8236630, 0xd4e2bbee, 0xfd15e7dc,
+    0x5a6c8874, 0x0796b16b, 0x3ffe6b65, 0x795a903c, 0x68a1d330, 0xc4396098,
+    0x1b1b8718, 0x316ef48b, 0xdb7dffe2, 0x13b04d52, 0xaeb9b727, 0x1347647b,
+    0xe937abad, 0x700b468b, 0x27cda358, 0x3b97e316, 0x14e2f828, 0x92467a40,
+    0xff326712, 0x79cb8e62, 0x02391072, 0x4556fd6c, 0x23a0c45e, 0x38a7754c,
+    0x896d741b, 0xb3ef5bb2, 0x21c2c59a, 0x8e53fd90, 0x8c0d03d1, 0x63003d86,
+    0xa101e4d9, 0xa8592531, 0xc79a4c7a, 0x89a72daa, 0x6af244f8, 0x454188d1,
+    0x4e8ba3b1, 0x8ce0372d, 0xe21c068a, 0x752bbc3c, 0xc508b74e, 0xb0e4f81a,
+    0xd63d121b, 0x7e9aeccd, 0x268f7eb2, 0x70b6df52, 0xd2e5dc47, 0x109884d6,
+    0xa13b2451, 0x1f1d6bf5, 0x5a7d10d8, 0x17fca53d, 0x8c24effc, 0xdace4eac,
+    0xb32af3c4, 0xc3779a64, 0xb2beb5d1, 0xdb20c635, 0x9dd60eb4, 0xd3b3f25f,
+    0xd7e15bb1, 0xb0a95d63, 0xd3512796, 0xc8c1fa7b, 0x80af4c5b, 0xcf13916c,
+    0xe99f21bc, 0x52131b2a, 0xf476dba4, 0x1f3908f3, 0x8a2f8952, 0xf184cd71,
+    0x331acc03, 0x2d5d6f16, 0xfc90d34f, 0xa3ee7998, 0x65543c84, 0x8d447717,
+    0x74016a65, 0x8537d6b8, 0x51a2bb7e, 0x002b95fc, 0xbb684b5f, 0x56c4f7bb,
+    0x193340a6, 0x78b7beec, 0xb828513d, 0x5f27f6b1, 0xc9b12fc9, 0xdcc4c698,
+    0x2c11f783, 0xd6ee3eef, 0x217e9599, 0x365385ee, 0x7bd62cdb, 0xfd228cc7,
+    0xd3bb90b0, 0x805648ac, 0x683f2f3e, 0x2d6e2d4e, 0xecc2e822, 0x166d1191,
+    0x443d6c41, 0x5ff80832, 0xb499e234, 0xef2ae057, 0x69109596, 0x7ec2e56a,
+    0x85cd8d9b, 0x3a9e2c7e, 0xdb99c03a, 0x91c86c45, 0x614f7951, 0x795aa8e3,
+    0x6a3e79e8, 0x005e5285, 0x2bdf2066, 0x7d4de458, 0xe6a49277, 0x6dffbdce,
+    0x4e361fc7, 0x90c8aafa, 0x0624e206, 0x82358cae, 0x14ac1492, 0xf9f8eadf,
+    0x9d7d570a, 0x7c14d8ca, 0x4af891db, 0xc03cd5c6, 0x60b8cce2, 0xed589001,
+    0x05a493fe, 0x9d7ede3a, 0xfb354477, 0x491c4193, 0x14d26ed4, 0x0e449a6e,
+    0xfc6751e9, 0xbfe1eac4, 0x867ec323, 0xfca15df7, 0xd6a16e1f, 0xbdafb2d2,
+    0x8121a690, 0x6541fe61, 0xa84f4a67, 0x31342cb7, 0xb2efdaae, 0x9037a566,
+    0xd8138595, 0xc2376744, 0x580ed4bd, 0x4fd21ef7, 0x22685e53, 0x9d8a0a4f,
+    0x79e4fe09, 0x1ba36ff3, 0xb7f48879, 0x2cf0bd84, 0xfe91424d, 0x64604486,
+    0xc9a2d966, 0x2de3b5a6, 0xc7b3b0e2, 0x571fd50e, 0x145d8740, 0x4d45c44b,
+    0xd606983a, 0x67dcc030, 0x7f9996ac, 0x7c4b5243, 0xff022556, 0x22fa6436,
+    0x58eb76a5, 0x303af107, 0x418941a8, 0x6602d8e5, 0x9b6e9118, 0xb9e35bb8,
+    0xe6810e08, 0x7b723ed3, 0x5eb4798e, 0xee6a952f, 0xf3d7d759, 0xd9af3e74,
+    0x1dcf8cd7, 0xb3e88f99, 0x699ea1e4, 0x10dfb86e, 0x9331fd81, 0x9b92b18e,
+    0x6988e842, 0x3826b755, 0xf6432ca9, 0x2bbc4294, 0x5ae3796a, 0xc231d955,
+    0x62d6d6fd, 0x68878bd2, 0x10731448, 0x9acb9d90, 0x0fca393a, 0x867bcfe0,
+    0x5e484a20, 0x792375db, 0xf94bd862, 0xd36334e3, 0xd7482b71, 0x14c80123,
+    0x923a5d18, 0xb52cf813, 0x744333ed, 0x66a8c860, 0xf3a0c2c6, 0x04f6a9db,
+    0x3ed44c52, 0x9d4d752f, 0x87d3483c, 0xff404f74, 0x838261ea, 0x2a2a4a1d,
+    0xca0ce4ce, 0x028da940, 0x62f593ff, 0x42082ec9, 0xdb7605db, 0xb7544f3a,
+    0xd6b02400, 0xda6e1ea5, 0x7a02737c, 0x8f1dbdf1, 0x1250f055, 0x581f1e34,
+    0x95240f4c, 0x785e874f, 0x0eab4fe9, 0x1a6d8e94, 0x6f0111ff, 0x1ecef031,
+    0x1ee18676, 0x00a4aa95, 0xc8b9e241, 0x17699026, 0x14df0f2e, 0x4d9dc3bc,
+    0x9ed4bbbd, 0xa2aceec0, 0x8d74368d, 0x18e122e1, 0x9a0422b2, 0x6db2d882,
+    0x91e7b0de, 0x84739b22, 0x4756dfe9, 0x02cda98f, 0x41e01c5a, 0xc13f3b5b,
+    0x435d0db1, 0x0fe533a0, 0xcce37f50, 0x571a739e, 0x70528873, 0x20310261,
+    0x111fbbd2, 0x5ef62ea1, 0x533b5262, 0x218503ed, 0x69823ec0, 0x9cb15e0c,
+    0x03e67f23, 0x18828529, 0xa140fcff, 0x372aa08a, 0x65f3ed86, 0x78f074e1,
+    0x72b2a10e, 0x63001a66, 0xe69a8afe, 0x1c0f28bd, 0x4f24bc86, 0x4e5c11b3,
+    0x4ffe3ac8, 0xeeaea960, 0x604b6ec3, 0x4b882931, 0x22b3303e, 0xc258fb12,
+    0x7cb798ca, 0x14a97d63, 0xa7b72b95, 0x65d5f5c5, 0x2063886b, 0xecb29c0e,
+    0x65cc4d28, 0x24483aa0, 0x00d26a14, 0x7ce87723, 0x9fa3b905, 0x78aeca98,
+    0x125303fe, 0x059f0c6a, 0x6c599290, 0xa2cc31a2, 0x9f9bb61b, 0x832d3e23,
+    0xd0f72848, 0xa6f2e0b8, 0x45e3b64a, 0x83c2b5ef, 0x1c477fbe, 0x14b060b3,
+    0x4c16cecf, 0x430cf214, 0x041a5caa, 0x0d3d6252, 0x20189da3, 0xda5292f6,
+    0x9912b4ad, 0xc214600e, 0x2a2ede6e, 0x3bd0823f, 0xebdee9f8, 0x1b4b4a3c,
+    0x63e7df3d, 0x397234d3, 0x84e88046, 0xfde15527, 0x0f33954a, 0x031789ee,
+    0xf672e611, 0xbd314d20, 0x182d5e52, 0x9f922523, 0x7aa56977, 0x86be9f96,
+    0xf134e0f5, 0x4c6ae342, 0xdcca539a, 0xfba1ba13, 0xce18656d, 0xaa8a9025,
+    0x30f99cb6, 0xb83b4ca9, 0x702d9ebc, 0x9782fe73, 0x4c510d47, 0xf2c85ac0,
+    0xe0c02d8b, 0x4abdb07a, 0xb74c316f, 0x887d18f8, 0xaab7b441, 0x39b2b585,
+    0x03c2ccf6, 0x8a26b66b, 0xe6e4f631, 0xa1a6ab58, 0xf2dcc77a, 0x5ae07204,
+    0x972646d0, 0xd8fb55dc, 0xbd21d248, 0x4788b32e, 0x6ca95f0e, 0x4f0a6641,
+    0xe72ebc41, 0x0e2e45a5, 0x558b752d, 0x86ca0944, 0xebdb8c32, 0x643f60d0,
+    0xe8bfde37, 0xca4578b1, 0x7334f281, 0x633726b8, 0xc39be549, 0x65ef8d50,
+    0xca19822e, 0x58e3ff40, 0xa2dd776c, 0x22f01d95, 0x240f1687, 0x473c3f0a,
+    0xd725533c, 0x14e18cde, 0xfa0f0d53, 0xf20c9394, 0xe90b010c, 0xfb1ea11f,
+    0x2eb8a775, 0xf4e67fcc, 0x0bd2081f, 0xb395feae, 0xa40b0196, 0x17942a00,
+    0x9f2b0c9a, 0x4aaeba78, 0x6661ed5a, 0x476c2653, 0x3e2f72f2, 0xc470a068,
+    0x7ba1fe92, 0x352893d5, 0x549f6f9e, 0x4d2916b3, 0x8a030ed2, 0x6f3425ad,
+    0x63979f27, 0x083f8f83, 0xe08d1616, 0xb6a9eb0a, 0x485aa896, 0x84be490e,
+    0xc157e030, 0x8c05ddef, 0x9d7d17a5, 0xbca6289d, 0x343eb3ea, 0xe79ef430,
+    0xf89cc67c, 0x5a0f8b1b, 0x676b4bf3, 0x7128e20e, 0xa5f9b362, 0xa0dbffd4,
+    0x1ab2be01, 0x50b23148, 0x4ef7c5a8, 0x0750c36e, 0xbb0e612c, 0x36433adc,
+    0x3ded3edd, 0xc93db1e3, 0xef6fe43f, 0x2116876f, 0x0d4c1714, 0x9cda8258,
+    0xe8e3841e, 0x27bffa64, 0xac384175, 0x75f25864, 0x613da382, 0x532bf160,
+    0x77087514, 0xe2f76cca, 0xdbf0e802, 0xafe3665c, 0x1ba7d191, 0x992af5fa,
+    0x67997cba, 0xc46d1a3b, 0x758f4f57, 0x87bb2162, 0xac09645b, 0xeccab708,
+    0x7189990a, 0xb38e041a, 0x2780d4eb, 0xedee2762, 0x7e76b905, 0x32da67de,
+    0xe3cb39d0, 0x95f1d806, 0x7a71102d, 0xff144727, 0x941b1281, 0x0939e387,
+    0xb09c8ce2, 0x76f3c059, 0xbef92953, 0xea015964, 0x72699172, 0x7dd89911,
+    0xf3ab92fd, 0xe5758495, 0x11117787, 0x0437e1c3, 0x300a161b, 0x0c707f7e,
+    0xd911f057, 0xe98968dd, 0x35fbda1a, 0x705eaf82, 0x6f260974, 0x5dea378d,
+    0xf54da801, 0xbd287f97, 0x3970ee22, 0xf956ff2e, 0x51d948c2, 0x38f744a7,
+    0x1d4d1b7a, 0x3852082d, 0xa0b02e5d, 0xd8adf411, 0x1de23417, 0x3933458a,
+    0x0d8e4c45, 0x8590eca3, 0xde081d16, 0x5a2543fa, 0xd67158ae, 0x1e4cc03c,
+    0x2ff45368, 0x2798f234, 0x263f79ac, 0xcf664fad, 0x6e6cc3c8, 0x9206c368,
+    0x771b1696, 0x67d6d296, 0xca25fef2, 0xbdf126e4, 0x30a090ff, 0x06dfad74,
+    0x4b703cdd, 0x77ff45ee, 0x1a5c8482, 0x325618fd, 0x7b17ef39, 0x08151d38,
+    0xb5ad37bb, 0x8ce42fd7, 0x556cb5cc, 0x6bfaba86, 0x563f0889, 0x95208611,
+    0x37754a3f, 0x8a677740, 0x14affba0, 0x932b77e8, 0x972cb402, 0x276f887d,
+    0xae900643, 0xb18c54e8, 0x019e288c, 0x059fcc19, 0x4ec7b9e2, 0xf231ca89,
+    0x5d7f8c84, 0xee14029c, 0xa508df56, 0x95343e96, 0xd26622d8, 0x06eef154,
+    0xb6ab36a8, 0xdc013239, 0x80bebe6e, 0xd2c00a77, 0xc8e9cd5d, 0x1d0cf4f0,
+    0x7216c878, 0x05b9cdbb, 0x64036340, 0x04957a84, 0x5338f226, 0xf8fc9dc0,
+    0xe66b1e03, 0x7712f3e9, 0x28bb622d, 0x752fe8d9, 0x324c1a37, 0xe194bb35,
+    0xccae5bc4, 0xaaf88490, 0x63a294da, 0xb487c4dd, 0x43260ab8, 0x55f39187,
+    0x3fabbe20, 0x3f7a550b, 0x28b0cfd2, 0xa954630c, 0xf6f7e7ab, 0x7eab88c1,
+    0xd1927926, 0x850badc4, 0xb66ce5f6, 0xe63a010e, 0xebd1e094, 0x2543a01b,
+    0x3a87c6b9, 0x324e7a03, 0xe1f42966, 0xffd72bb5, 0x4310ab29, 0x4aad3735,
+    0x7e17c9a3, 0x5b6abe95, 0xf1854e24, 0xd3c927b4, 0xbd511bbc, 0x2846716b,
+    0x561d94a0, 0xcacbd648, 0xe29feb3d, 0x09a9d3fb, 0x2e211f02, 0xea46b6a7,
+    0x97d163bf, 0x17d52a6d, 0xf2be0ebc, 0x89e4046c, 0x83efa98d, 0x987c88c7,
+    0x9ea7c988, 0xed7f3085, 0x51934468, 0x686fd65a, 0x2de416b7, 0xc81a234b,
+    0x09ccd8a2, 0x496069e7, 0x07326ff5, 0xb19f7a02, 0x33be6b9b, 0x2d41f65b,
+    0x250c12ed, 0x27353830, 0x0111d24a, 0x713b3179, 0x6da16e1f, 0x40e82173,
+    0xa68c0fd4, 0xcd052ff2, 0x1141df38, 0x76186977, 0x293bc29a, 0x77f313e4,
+    0x948103d5, 0x69254810, 0xb157e47f, 0x5c13716e, 0x5451a6ca, 0x690f4192,
+    0x4b032cc2, 0xf740a68b, 0xc1aa602b, 0xcfa93b80, 0x001fff5d, 0x3271cb86,
+    0xc271502b, 0x8191bdcc, 0x95e98e8c, 0x293417eb, 0xde7816ad, 0x21512e21,
+    0x702d7ea2, 0x9e492860, 0xbb788b3c, 0x0948089e, 0x32962a5b, 0xca4246a9,
+    0xba5c56db, 0xad84fc1d, 0xb27bbf50, 0xc4e7b17f, 0x5f3cbb69, 0x85c307b7,
+    0x59321224, 0x7459cd2e, 0xb5230963, 0xa805805a, 0x8040aa45, 0x275bc487,
+    0x9880f01d, 0x43f7d49d, 0x29e6c19d, 0x3f8ecbf5, 0xb1d45859, 0xdad8b35a,
+    0x185e9f40, 0xb964c751, 0xe4b76e27, 0xae42c4d8, 0x29857568, 0x13415dc5,
+    0x15b51eef, 0x8ed24aa6, 0x30e9e6e9, 0x4dad3b31, 0x64a95913, 0xec1deb15,
+    0xa3607db6, 0xa1db7bb7, 0x909aa61e, 0x6cf0c59c, 0xdaab8527, 0x59c059bd,
+    0x6ab2d056, 0xcfbb6b72, 0x1ce829bd, 0xc3a47454, 0x3e1b72aa, 0x0b3746e5,
+    0xe3cc0d3c, 0x8c66f9f6, 0x18ca4ce7, 0x85b75aa1, 0xa0835f63, 0x27d3b766,
+    0xee2a10fa, 0x6157df44, 0x23ec80af, 0x527aa66a, 0x44f252c9, 0xaaac6b4a,
+    0x2fcaad56, 0x9d65bc8c, 0x8fcd86f0, 0x24653547, 0x52b5f6a4, 0x2f9c0f73,
+    0x8f613d39, 0x0da8833c, 0x7230920f, 0x954f9b24, 0x1c211540, 0x874a87d9,
+    0xff7d7d2f, 0x1a8ca2a9, 0xeddfe2fa, 0x876536f9, 0x95c9092b, 0x18a44f34,
+    0xc664744d, 0xaefb26ae, 0x78a3dd92, 0x307f3b1d, 0x5f1d18e6, 0x824ee018,
+    0x17e9432f, 0x8d926353, 0xf7d7a0a5, 0xd2c6534b, 0x6a30dd9a, 0xb019b70f,
+    0x36cff5b9, 0x1ed5d135, 0xbe14654c, 0xa6c89f9d, 0xa0404372, 0x0696bd70,
+    0xc79b0a77, 0xb4c286ea, 0x917ba3af, 0x5174e50f, 0x884a5b2f, 0x12fbccb2,
+    0x3b0f2541, 0xa6e2b26d, 0x7dbce431, 0x7e6a1c10, 0xe5bfbf36, 0x34a446bc,
+    0xeea1eb01, 0x9cb8b3d7, 0xc7d8196d, 0xbbcbda38, 0x87be6a06, 0x2886160e,
+    0x45d54479, 0x7a8a3668, 0x2c2169c8, 0xd91da0a1, 0xf5b90eb0, 0x84e9e90b,
+    0xa75311d0, 0xd927de1e, 0xfd229877, 0xadcedfd9, 0xef49a1c9, 0x66416a5b,
+    0xfa780c7e, 0x61f58a09, 0x489bd921, 0xc3b73fc0, 0xd9d73786, 0xa5165f95,
+    0x5f015ec5, 0x42c8213d, 0x402dbba2, 0x2245ab6a, 0xe1848ba4, 0x3bca6414,
+    0xa29b9b47, 0xb1fadc11, 0xfb3ad63e, 0x02f77b43, 0x2436e546, 0x7c90b05d,
+    0x143b014f, 0x066563a8, 0x00feefb1, 0xf9ccc2f4, 0x06993209, 0x90ad4cb5,
+    0xe431fb60, 0xc1acbdd5, 0xe7be24ed, 0x23879523, 0x8685d47f, 0x51977357,
+    0x30a660c0, 0x53ac7537, 0xdd71979e, 0x1d547304, 0x1297f235, 0x1f8758a5,
+    0x0c2d245d, 0xc497b5f4, 0x3d15b491, 0xc22ac89f, 0x9b603eb8, 0xb4b1bcc7,
+    0x49aefc68, 0x36550d42, 0x8231a046, 0xc8553a06, 0x6aee972c, 0x185fccb3,
+    0xbf0a6b74, 0xbb283b04, 0xd6376c0c, 0x8c794f0e, 0xaaef5473, 0x448e79ae,
+    0x7d10db95, 0x6fa7492f, 0xb1b4a36c, 0xdcde71b3, 0x15ddbfa2, 0x570eb001,
+    0xfd057441, 0x93edf010, 0xfdcba66d, 0x72ef9c23, 0xa33f8f80, 0x1d003332,
+    0xdef2d435, 0x018536fe, 0x8aab401d, 0x98302e96, 0xfbd4036d, 0xc39f9066,
+    0xde1fe6fb, 0x20192dfe, 0x0c02330d, 0x87690b11, 0x144b2ead, 0x7b5c4376,
+    0x3046e3f3, 0xe5735ac3, 0x9340beb3, 0x5aebb166, 0xede47374, 0x4d7e8562,
+    0xcab40f45, 0x1052bc41, 0x989f347d, 0x138e40a6, 0xcffe5929, 0xe90a8fd7,
+    0xee024b3b, 0x80d19d4a, 0x85ac9095, 0xfe4cd696, 0xeb0b13fe, 0x9953a468,
+    0x51fd913b, 0x072012f5, 0x225d31a3, 0x2eceedb3, 0x7b7d4979, 0xc91f10b5,
+    0x2a23b3c4, 0x77582cc8, 0x55be035d, 0xde155201, 0x7383a4a1, 0x529155cd,
+    0x0f9e46d8, 0xbd568de8, 0x7a41acf1, 0x99d8b9ee, 0x96bd4b75, 0xd29e7645,
+    0x211ae773, 0xab3c40ba, 0xda879397, 0xdd207f57, 0x612b48fa, 0x0402e99a,
+    0xbf340f91, 0xd285d7f4, 0x9fbe674b, 0xfaa805d4, 0x2f986b0c, 0xb9eb641a,
+    0x16ac151a, 0xaefeb56d, 0x32c4ff05, 0x4ad6f9e9, 0x9460348e, 0x083a6237,
+    0xd2cd448b, 0xb8a8a6cf, 0x54bbe903, 0xb99e70eb, 0x636ff0ad, 0x45e996d9,
+    0x4acb6752, 0x05c98ad7, 0x97ce634f, 0x76091eca, 0xc408cd7d, 0xa63e6809,
+    0xad59b6f3, 0x424dcc8c, 0x1834df1d, 0xfd69f494, 0x3757e4ad, 0x60027724,
+    0x0a45a1b1, 0x830aba30, 0x637123a5, 0xbef032d6, 0x2411f321, 0x7ae7b6b1,
+    0x3f9a5e9f, 0x9cd5c4a7, 0x1a65589d, 0x6f12ced2, 0x83f17841, 0xe1aa1705,
+    0xbb0a2735, 0xf2dde631, 0x7744d013, 0x1994ba34, 0xfa12d169, 0x259f3ca8,
+    0x91b4ea72, 0x5e017819, 0x0c9f4efe, 0x7c342ff3, 0x78ff0691, 0x94c1c58e,
+    0xd397f7f8, 0x3633a1c7, 0xe78b3a45, 0x8cb25e98, 0x51ac96cd, 0xe0c5c058,
+    0xc5c6ea59, 0x87afe75b, 0x46de537d, 0x12f444f9, 0x7f7e3f0c, 0x309da481,
+    0x4a3b4e2a, 0x000e83c5, 0xd56d1e5c, 0x1c05b763, 0xe40be0f6, 0xff24ef7f,
+    0xa32e8bd3, 0xcc2f5516, 0x6aa3406b, 0xb2c33087, 0x304fe34d, 0x549bb038,
+    0xa6902ea5, 0xb41e2457, 0x4caf2b18, 0xdf802e49, 0x236fb4d5, 0x32e55c63,
+    0x3440b088, 0xdb60c181, 0xf0ef26a4, 0x0d4bfc5a, 0xfa2772d9, 0xa7a123ca,
+    0x10d7a042, 0xbcfca5f0, 0x3c557917, 0xb53a98a5, 0x29bf4a37, 0x0a469104,
+    0x6d03de14, 0xa401deb4, 0xd87ef795, 0x7b9c85b7, 0xf2fecfa7, 0x38674d62,
+    0x26979930, 0xdd2a354a, 0x2d135ed2, 0x143c86ec, 0xbb7d8136, 0x1a07ed0c,
+    0x05bcb33e, 0x2400a04a, 0x97397b74, 0x63b0be90, 0xc31c62d7, 0x59e9c314,
+    0x66454a80, 0x4c378c51, 0xf4408f18, 0x402f62d8, 0x68dd4ccb, 0x8d0b5c50,
+    0x27be2780, 0xa7eb940e, 0x30de8e7c, 0x161bcd0a, 0x5b5d229b, 0x8c8473f5,
+    0x62c0c0ef, 0xcb1c40f2, 0xdb677382, 0x52079082, 0xe61ffefc, 0x3acc0695,
+    0x292830b5, 0xaca4aa0e, 0x646bfe2f, 0x873e2162, 0xa594e5f8, 0x9c757a82,
+    0x94797ece, 0x4584636e, 0xac942358, 0x38ce679c, 0x3965cbc0, 0xa3ec2348,
+    0x8108401d, 0x7dbb9f12, 0x341de079, 0xa144e74d, 0xd80aa510, 0xd80cac11,
+    0x7177d214, 0x63f55de4, 0xfd9d017a, 0x58a08c8c, 0xbd6d055e, 0xb1ecab89,
+    0xf75199cf, 0x5d45e1cf, 0xbcb3e31f, 0xa84004a5, 0xde051f36, 0xa6acc363,
+    0x19c8c2ca, 0xb56d53ac, 0xbeec7b1c, 0x315cebed, 0x0fce0cb7, 0x0f105ced,
+    0x167c23bc, 0x28e61f41, 0xafe10b64, 0x4f5e100d, 0x4a8b297b, 0xe81468f7,
+    0xe374aff2, 0x850bdf9b, 0x870257af, 0xe976f098, 0x58fbfca7, 0x590cb4a3,
+    0x97de1e7f, 0xf28677d5, 0xfb26c780, 0x31a61bb9, 0xa9726892, 0xe8592a40,
+    0x5426e7ae, 0x329c51c9, 0x7a70496c, 0xf6c042f1, 0xe6097117, 0xb08cd059,
+    0xfe39ebe7, 0x921527e6, 0x3b0f946d, 0xabe63625, 0x567f914c, 0x3fd33e25,
+    0xddaf3d8d, 0x3c0de63a, 0x46d121d8, 0xe649bf21, 0x58538e03, 0x39c4288f,
+    0x44b9dc83, 0x8d1aa96a, 0xc9e6f705, 0xf3dd403a, 0xae611294, 0xaad1b502,
+    0x2543055e, 0x072dee4b, 0xe7cacf74, 0xe478dead, 0x5ed5b351, 0xb2f38b60,
+    0x549ef4ff, 0x6fa90194, 0xec07f3f3, 0x34e13f1b, 0xab0e8f8f, 0x866d3ce4,
+    0x42ef35f4, 0xe2c15437, 0x5f4836ce, 0xf13763dd, 0x3e56d173, 0x37108ee2,
+    0x1e1e71a4, 0x8bad88ce, 0x9dbdc27f, 0x7e17b6dd, 0x5fecac51, 0x240f2e62,
+    0x65ffd59c, 0x0f647e2d, 0x82efd10d, 0x9c59db39, 0x179eb995, 0xb56f7314,
+    0x5c1f6580, 0x2e94e293, 0x93b82fa3, 0x1cadd09e, 0x9ca2ab38, 0xfb877212,
+    0x252ba8da, 0x9a1beef6, 0x3a547668, 0xe859fb7b, 0x112a1e2d, 0xd7efcb73,
+    0x9176ab8c, 0xfd1d9f22, 0x4847fce3, 0x62ebd99c, 0x3f500427, 0xa9ffa2ba,
+    0x29c1e700, 0xb0b27341, 0x281ecd26, 0x3c6c4884, 0xb3456715, 0x3041b16f,
+    0x91b5963a, 0xb438f4dd, 0xf9dbdda9, 0x8d50eab5, 0x6fb8dbab, 0x24242fd8,
+    0x6997ed99, 0xd89f0869, 0x549ea309, 0xd697e6d0, 0x72c479ff, 0x1464b483,
+    0x1c902e40, 0xb45e181d, 0xf506b6cd, 0xa5be36f9, 0x5cd90232, 0x70e902e2,
+    0xad7ce1c1, 0xe09545fc, 0x25733cd9, 0xd155f6c6, 0x5bac9300, 0x6ac9f9c6,
+    0xa2fcf912, 0xe5fbf492, 0x77d55357, 0x6b985390, 0x0c906add, 0xe560a440,
+    0x0d374077, 0x01393ea3, 0x3537b61a, 0x32aaacaa, 0x800001eb, 0x98557ba4,
+    0xe5e582ca, 0x46260a53, 0x5d4aca5e, 0x830802b9, 0x3fb8d372, 0x62801ce2,
+    0x801dcd18, 0x7249bd57, 0x2e3f2174, 0x652bc7c2, 0x759221f9, 0x9a23b2da,
+    0xdb854c3d, 0x05682085, 0x85ed9ef8, 0x365b4f65, 0x9a71d9ff, 0x9ca1c112,
+    0x33e20bcd, 0x05bda7e0, 0x42f31e48, 0x5b3ecde1, 0x2b6bd962, 0xc628c760,
+    0x99a05f36, 0x41214874, 0x03534209, 0x10e9e952, 0xdd079a38, 0x45681971,
+    0xd3f2d39a, 0x1b9afab4, 0x3a5aea7c, 0x7b32f07e, 0x85328795, 0x1c71e8f9,
+    0x788231be, 0xea4b2fbe, 0x3d025858, 0x9c520dd6, 0xacf75227, 0x2a43a6af,
+    0x752d4591, 0x9e2d8a17, 0xafbcd59a, 0x07045844, 0x06b09da2, 0x02aa78af,
+    0xa1cbd6cb, 0x0e7c7b83, 0xaac01548, 0xed9f5f9c, 0x5b343662, 0x388ea73e,
+    0x3e44e041, 0xee59f08f, 0x24c65b32, 0x43d6b5ed, 0x96ca3583, 0x6a951fc5,
+    0xc9562802, 0xe4cf4023, 0x13216401, 0x7a54909e, 0x1aebd05d, 0xc1854a57,
+    0x5080daba, 0x15fa7fde, 0x50a7e034, 0x76215789, 0x42bb8abc, 0x0f1b5a2a,
+    0x062a87c8, 0xafd21fff, 0x52fab967, 0xf4394544, 0xe0267857, 0x47d0e089,
+    0x8b6b459b, 0x869fc58c, 0xc94c5478, 0x1e747870, 0x6e31d762, 0x6a1da64b,
+    0x431ea28a, 0xee82137a, 0xed581573, 0xf7da00c0, 0x26543845, 0xc8b0b536,
+    0xe28d984c, 0xaa3e97ed, 0x5d39774b, 0xbc8ac5a9, 0xe2da1dd9, 0xb41d99db,
+    0x71d1203a, 0x82d57064, 0x6209b00c, 0x4748f9a4, 0x8170f03d, 0xfab5e7dc,
+    0x9004b544, 0x214e1f92, 0x203fcca2, 0x153d0677, 0x46b6848d, 0xfe7d3280,
+    0xee22bde8, 0xd7a4c567, 0xa87aacc9, 0xc9cb5ce9, 0x0b288b20, 0x659197ab,
+    0x471b3946, 0x996bc687, 0x8d836f64, 0x2834ccd0, 0xaf789a78, 0x43f6614e,
+    0x1eec6e84, 0x7d062fc4, 0x21680aba, 0xd3d04160, 0x54b1c57c, 0xe5914c94,
+    0x09e60c4c, 0xdc6d9bfb, 0x59097fd6, 0x0fae9b31, 0x17a5ebea, 0x762d4bca,
+    0xde1046c3, 0xa19258aa, 0x7964f655, 0xd291502b, 0x9bcf02aa, 0x7e9ddb95,
+    0x42c77fb8, 0xf4ca82d2, 0xdac8957b, 0x5bed25d4, 0x521c2924, 0xad7a4f48,
+    0x4951f3c7, 0xeece5c31, 0x95dce989, 0xa66c5b81, 0x34f1fc8f, 0xde226330,
+    0x3e8d54eb, 0x07a43450, 0xf52718e4, 0xf574158b, 0x50fe14f7, 0x6a70789f,
+    0x61742e3f, 0x969270d4, 0x1fc4c026, 0x68f4765e, 0x1b8e4210, 0x03579b53,
+    0x55b04ac0, 0x20c25f81, 0x378dc0cd, 0x1f30a23e, 0xf562645d, 0x56dbbb71,
+    0x69fd816c, 0x541dc0aa, 0xcd0a6aed, 0xcdc96e04, 0x562ed176, 0x5f73b454,
+    0xd519b12b, 0xf46d9c5d, 0x6a1ecabf, 0x3b8a6908, 0x94d3f561, 0x9c6365f2,
+    0x913768f0, 0xaa1d4480, 0x36f6ab2a, 0x634887cd, 0x66518ca1, 0xdbf5a970,
+    0xc89ed164, 0x01375792, 0x6ebf8318, 0xdcc79812, 0xbd443c20, 0x8cc4eef2,
+    0x157a93f1, 0x703c6138, 0xda329ddb, 0x69f46dd7, 0xb3f0f090, 0xb888a275,
+    0xccdf9658, 0xa3844ab8, 0xfedda96e, 0x190aa7f3, 0x3d44cea6, 0x383c7eeb,
+    0x2c6e7be4, 0xf61e5ac3, 0xfdf01ba0, 0x74665872, 0x4302e15d, 0x0c885049,
+    0xcc1ff004, 0x5b6eef87, 0xdc6b6cd2, 0x89c69586, 0xb6b1262a, 0x177e9c5a,
+    0x807db78d, 0x0508d6d1, 0x27c6d582, 0x34c50910, 0x3075e3b9, 0x3b783ff1,
+    0x29651b40, 0xe3b89b64, 0x3552f13b, 0x5ac70c81, 0x8ee203c2, 0xa70dd3d7,
+    0x82b690be, 0x2ecfaf58, 0x34cb9817, 0x83337bb8, 0x866cf3e0, 0x340062c2,
+    0xe2658489, 0x725760f5, 0x0df0b33c, 0xbf6294f3, 0x2d2c0ab0, 0x608669e6,
+    0xf25cc626, 0x5c28e83e, 0x8e6dc700, 0xc427f5d2, 0x17a80ed6, 0x0ba2c938,
+    0xced4e92e, 0x5a52144c, 0xaedb730b, 0x035b4991, 0xc811928d, 0x38875f50,
+    0x306d263b, 0x0ff073dd, 0xc45c0c1e, 0xae206a5d, 0xfbdd68ff, 0x39b19001,
+    0xc2228efb, 0xaaed4bda, 0x5a711569, 0x61884725, 0xe5534393, 0x73aef06f,
+    0x8b586ec4, 0x0afec6cc, 0x2154c7cb, 0x4212a59c, 0x84ba06e5, 0x424d0b27,
+    0xa04ebb13, 0xfcab8288, 0x04f04c0e, 0xef12da10, 0x67a2dba9, 0xb4804538,
+    0x3a4b1e7c, 0x9829a438, 0x775f4c74, 0x0acefc0e, 0xbf481cae, 0x5bf7bec2,
+    0x99996b4d, 0x19b08653, 0xfca4cf94, 0xcd73cd44, 0xd219b8dd, 0xe7b4eba6,
+    0xfd085458, 0xff121a98, 0xab85e5c4, 0x356b1731, 0x0fe7c6dc, 0x5a93212d,
+    0xacd90a93, 0x8ef53a8b, 0xfd8ee3fc, 0xa1fd944c, 0x827a11b7, 0xe528e9f5,
+    0x0fafd16a, 0x42f297ee, 0xcca1815a, 0x96bbe594, 0x4ac890eb, 0xc5253747,
+    0x9f48fe84, 0x71e77980, 0x964bead8, 0x3d81c609, 0x224863b9, 0x03484d4d,
+    0x10dd38d5, 0x02701ca1, 0xb81b2629, 0x029faa99, 0xea947128, 0x16383138,
+    0x8095f183, 0xdd3ed1ee, 0x1c09c31e, 0x79e0c032, 0xfbe65bfd, 0x85059670,
+    0x9a0898b0, 0x40c9e8c0, 0x5eda433c, 0x18142a34, 0x1eed5397, 0xcd13c9c8,
+    0xf925c67e, 0x2a5ceec4, 0x648674a4, 0x505d64ae, 0x37a8ea4f, 0xbc1484da,
+    0x02d772cf, 0xea3b98e3, 0x605e618b, 0xba504f1f, 0xd6c4c326, 0x2128d558,
+    0xd0bfa78c, 0xd42b67d6, 0x02d9a5ec, 0x143dcf75, 0x9b310056, 0x814f7557,
+    0x13387e34, 0x60538c30, 0x1234bde6, 0x5f24bc62, 0xfd624e11, 0x9f1e863b,
+    0x4f8691d0, 0xd60627e9, 0x3ea51e9f, 0xf8aacf0b, 0xde8cf13e, 0xb0aea0ad,
+    0x10eebfaf, 0x0c45ea5b, 0xcc7b2ba2, 0x81538bc0, 0xf8a95ff1, 0x542efc32,
+    0xbbed706b, 0x9b1019ab, 0xffd85b0b, 0x1d4567e9, 0xc1928b42, 0xe51702de,
+    0xc061cf14, 0x90cb474b, 0xb8b7b654, 0xc8cfffc7, 0xa75ad2c5, 0xa039ae61,
+    0xcc3aa3b1, 0x51a68f11, 0x075e2697, 0x296de2e2, 0x249936ec, 0x6835b310,
+    0x9086d530, 0xbf83918b, 0xbd343d0e, 0xdacc20e2, 0x2b467954, 0xb35c36d7,
+    0xf56cc45d, 0xa2776d32, 0xfd4262bd, 0xc6f34883, 0x27859202, 0x52b2e47d,
+    0xf85dd1ab, 0xb90882ae, 0x74460c16, 0xbe7948bb, 0xbcaa7882, 0x9dc105c5,
+    0x4697c798, 0x49ab1541, 0x08e7ecc2, 0xef6f7063, 0xb57c7a73, 0xf6c22fb2,
+    0x6da7340a, 0x6839cfaf, 0xd196471a, 0x415d5c4a, 0x44480c33, 0xb77c966d,
+    0xf910e0ef, 0xd30fa140, 0xb7d54a1f, 0x0e1acedf, 0xb016faf2, 0x73563cb7,
+    0x9e48ea56, 0xc480c3bd, 0x91a3ac64, 0xb34da46a, 0x22ee8931, 0x085810b9,
+    0x6e0aabe1, 0x60e798ff, 0x2f8255f3, 0x0218b193, 0xbb5df76e, 0xab9bd8cd,
+    0x8a62fe92, 0xba0f4b28, 0x19f6097a, 0xdda1790c, 0x23ce0025, 0xe6b1b9a1,
+    0x0eb010b9, 0x4ce887d6, 0x4a856804, 0x94b42cae, 0xaa352888, 0xd6a194f9,
+    0x6f941f55, 0x45d8f654, 0x88060dd4, 0xef94aa39, 0x1a133eae, 0xc76a5c71,
+    0xa084f976, 0x258e7094, 0x228fe968, 0x67e0bcef, 0xe6c9c4d5, 0x5e6e0f78,
+    0x814d2648, 0xb783ba57, 0x07b3ce2d, 0x413ec164, 0xcdabcc34, 0x8b882371,
+    0x51e747af, 0x565627d7, 0xa34e205a, 0xd1dab2d8, 0x8d8005cf, 0xbec7338b,
+    0x72ffbffd, 0x87e26ed8, 0xcab58820, 0x0baff7ae, 0xfd1709ce, 0xf1bba77f,
+    0x3bac4ef9, 0x738184e5, 0x8043e207, 0x2551dfef, 0x06670f12, 0x1707c014,
+    0x1ec9e310, 0x848a8fbf, 0x36ddb8aa, 0x5e3c8fde, 0x7f72e5a5, 0xc3c494c9,
+    0x2ca4db43, 0xab9c57c9, 0x653ad9ea, 0xc468a9fb, 0x4562a5a3, 0x9e34811e,
+    0xa666c369, 0x2b573357, 0xfb0e9aa6, 0xaaf17010, 0x2c49faf0, 0xb2a3ebf7,
+    0x05909ba4, 0xc51cc26b
+};
+
+static inline const unsigned int *hash_table() { return rndseq; }
+
+/* hash_term
+   Random number selected by integer x at position i of the hashed array
+*/
+static inline long hash_term(const unsigned int *rndseq, long x, int i,
+                             int increment) {
+  /* add random table offset for this dimension and wrap around */
+  long index = x + increment * i;
+  index %= 2048;
+  while (index < 0)
+    index += 2048;
 
+  return (long) rndseq[(int) index];
+}
 
-long hash_UNH(int *ints, int num_ints, long m, int increment) {
-  static unsigned int rndseq[2048];
-  static int first_call = 1;
-  int i, k;
-  long index;
+/* hash_sum
+   Sum of random numbers selected by an array of integers (never negative)
+*/
+static long hash_sum(int *ints, int num_ints, int increment) {
+  const unsigned int *rndseq = hash_table();
   long sum = 0;
 
-  /* if first call to hashing, initialize table of random numbers */
-  if (first_call) {
-    for (k = 0; k < 2048; k++) {
-      rndseq[k] = 0;
-      for (i = 0; i < (int) sizeof(int); ++i)
-        rndseq[k] = (rndseq[k] << 8) | (rand() & 0xff);
-    }
-    first_call = 0;
-  }
+  for (int i = 0; i < num_ints; i++)
+    sum += hash_term(rndseq, ints[i], i, increment);
 
-  for (i = 0; i < num_ints; i++) {
-    /* add random table offset for this dimension and wrap around */
-    index = ints[i];
-    index += (increment * i);
-    index %= 2048;
-    while (index < 0)
-      index += 2048;
+  return sum;
+}
 
-    /* add selected random number to sum */
-    sum += (long) rndseq[(int) index];
-  }
-  index = (int) (sum % m);
+/* hash_UNH
+   Takes an array of integers and returns the corresponding tile after hashing
+*/
+long hash_UNH(int *ints, int num_ints, long m, int increment) {
+  long index = (int) (hash_sum(ints, num_ints, increment) % m);
   while (index < 0)
     index += m;
 
   return index;
 }
 
+/* hash_sums
+   Sums for increments 449 and 457 of an array of integers, in one pass
+*/
+static void hash_sums(int *ints, int num_ints, long &sum449, long &sum457) {
+  const unsigned int *rndseq = hash_table();
+
+  sum449 = 0;
+  sum457 = 0;
+  for (int i = 0; i < num_ints; i++) {
+    sum449 += hash_term(rndseq, ints[i], i, 449);
+    sum457 += hash_term(rndseq, ints[i], i, 457);
+  }
+}
+
+/* claim
+   Inserts entry ccheck (a check value plus one) into free entry j; entries of
+   tables shared by concurrent learners are claimed with compare-and-swap, so
+   that a learner losing the race sees the entry inserted by the winner
+   instead.  Returns 0 if ccheck was inserted, or the entry found.
+*/
+static int claim(collision_table *ct, long j, int ccheck) {
+  int *data = ct->data();
+  int found = 0;
+
+  if (ct->concurrent) {
+    found = __sync_val_compare_and_swap(&data[j], 0, ccheck);
+    if (found == 0) __sync_fetch_and_add(&ct->used, 1L);
+  } else {
+    data[j] = ccheck;
+    ct->used++;
+  }
+  if (found == 0) ct->touch(j);
+  return found;
+}
+
+/* resolve_safe
+   Looks up (and inserts) check value ccheck starting from home entry j, where
+   sum449 is the hash sum the double hashing step is derived from (legacy
+   tables); tiles finding no entry within the probe limit share entry j
+*/
+static long resolve_safe(collision_table *ct, long j, int ccheck,
+                         long sum449) {
+  int *data = ct->data();
+  int found = data[j];
+
+  ccheck += 1; // as stored: below 2^31 - 1, so that 0 is free
+  if (found == 0 && !ct->frozen) found = claim(ct, j, ccheck);
+  if (ccheck == found || found == 0) {
+    ct->clearhits++;
+    return j;
+  }
+  if (ct->safe == 0) {
+    ct->collisions++;
+    return j;
+  }
+
+  const long mask = ct->size - 1;
+  long step = 1, limit = collision_table::PROBE_LIMIT;
+  if (ct->probing == collision_table::PROBING_DOUBLE) {
+    step = 1 + 2 * (int) (sum449 % ((MaxLONGINT) / 4));
+    limit = ct->size - 1;
+  }
+
+  long k = j;
+  for (long i = 1; i <= limit; i++) {
+    ct->collisions++;
+    k = (k + step) & mask;
+    found = data[k];
+    if (found == 0 && !ct->frozen) found = claim(ct, k, ccheck);
+    if (ccheck == found || found == 0) {
+      if (i > 10) LOG(101, "tiles hash collision resolved after %d tryings", i);
+      return k;
+    }
+  }
+
+  if (ct->overflows++ == 0) {
+    std::cerr << "Collision table overflow at load factor " << ct->loadFactor()
+              << ": tiles share entries from now on" << std::endl;
+  }
+  LOG(101, "tiles hash overflow, sharing entry %ld", j);
+  return j;
+}
+
 /* hash
    Takes an array of integers and returns the corresponding tile after hashing
 */
 long hash_safe(int *ints, int num_ints, collision_table *ct) {
-  long j;
-  long ccheck;
+  long sum449, sum457;
+  hash_sums(ints, num_ints, sum449, sum457);
 
   ct->calls++;
-  j = hash_UNH(ints, num_ints, RL_MEMORY_SIZE, 449);
-  ccheck = hash_UNH(ints, num_ints, MaxLONGINT, 457);
+  return resolve_safe(ct, (int) (sum449 % ct->size),
+                      (int) (sum457 % MaxLONGINT), sum449);
+}
 
-  if (ccheck == ct->data[j])
-    ct->clearhits++;
-  else if (ct->data[j] == -1) {
-    ct->clearhits++;
-    ct->data[j] = ccheck;
-  } else if (ct->safe == 0)
-    ct->collisions++;
-  else {
-    long h2 = 1 + 2 * hash_UNH(ints, num_ints, (MaxLONGINT) / 4, 449);
-    long i = 0;
-    while (++i) {
-      ct->collisions++;
-      j = (j + h2) % (RL_MEMORY_SIZE);
-      if (i > RL_MEMORY_SIZE - 1) {
-        PRINT_VALUE("Out of Memory!");
-        Log.log(101, "tiles hash out of memory");
-        Assert(0);
-        const_cast<int &>(ct->safe) = 0;
-        break;
-      }
-      if (ccheck == ct->data[j])
-        break;
-      if (ct->data[j] == -1) {
-        ct->data[j] = ccheck;
-        break;
-      }
+/* batch_sums
+   Hash sums (for increments 449 and 457) of the coordinates of every tiling,
+   leaving out the first integer variable, which is summed in per value
+*/
+static void batch_sums(
+    long sum449[], long sum457[], long value449[], long value457[],
+    int num_tilings, float floats[], int num_floats, int ints[], int num_ints,
+    const int values[], int num_values) {
+  const unsigned int *rndseq = hash_table();
+  int i, j;
+  int qstate[MAX_NUM_VARS];
+  int base[MAX_NUM_VARS];
+  long fixed449 = 0;
+  long fixed457 = 0;
+  int first = num_floats + 1; /* position of the batched integer */
+
+  for (i = 1; i < num_ints; i++) {
+    fixed449 += hash_term(rndseq, ints[i], first + i, 449);
+    fixed457 += hash_term(rndseq, ints[i], first + i, 457);
+  }
+
+  /* quantize state to integers (henceforth, tile widths == num_tilings) */
+  for (i = 0; i < num_floats; i++) {
+    qstate[i] = (int) floor(floats[i] * num_tilings);
+    base[i] = 0;
+  }
+
+  for (j = 0; j < num_tilings; j++) {
+    sum449[j] = fixed449 + hash_term(rndseq, j, num_floats, 449);
+    sum457[j] = fixed457 + hash_term(rndseq, j, num_floats, 457);
+    for (i = 0; i < num_floats; i++) {
+      int coordinate = qstate[i] - mod(qstate[i] - base[i], num_tilings);
+      sum449[j] += hash_term(rndseq, coordinate, i, 449);
+      sum457[j] += hash_term(rndseq, coordinate, i, 457);
+      base[i] += 1 + (2 * i);
+    }
+  }
+
+  for (int k = 0; k < num_values; k++) {
+    value449[k] = hash_term(rndseq, values[k], first, 449);
+    value457[k] = hash_term(rndseq, values[k], first, 457);
+  }
+}
+
+void GetTilesBatch(
+    int tiles[],
+    int stride,
+    int num_tilings,
+    int memory_size,
+    float floats[],
+    int num_floats,
+    int ints[],
+    int num_ints,
+    const int values[],
+    int num_values) {
+  long sum449[MAX_NUM_TILINGS], sum457[MAX_NUM_TILINGS];
+  long value449[MAX_BATCH_VALUES], value457[MAX_BATCH_VALUES];
+
+  Assert(num_ints > 0);
+  Assert(num_tilings <= MAX_NUM_TILINGS);
+  Assert(num_values <= MAX_BATCH_VALUES);
+  batch_sums(sum449, sum457, value449, value457, num_tilings,
+             floats, num_floats, ints, num_ints, values, num_values);
+
+  for (int k = 0; k < num_values; k++) {
+    int *t = tiles + k * stride;
+    for (int j = 0; j < num_tilings; j++)
+      t[j] = (int) ((sum449[j] + value449[k]) % memory_size);
+  }
+}
+
+void GetTilesBatch(
+    int tiles[],
+    int stride,
+    int num_tilings,
+    collision_table *ctable,
+    float floats[],
+    int num_floats,
+    int ints[],
+    int num_ints,
+    const int values[],
+    int num_values) {
+  long sum449[MAX_NUM_TILINGS], sum457[MAX_NUM_TILINGS];
+  long value449[MAX_BATCH_VALUES], value457[MAX_BATCH_VALUES];
+  long index[MAX_NUM_TILINGS];
+  int ccheck[MAX_NUM_TILINGS];
+  const long mask = ctable->size - 1; /* size is a power of 2 */
+
+  Assert(num_ints > 0);
+  Assert(num_tilings <= MAX_NUM_TILINGS);
+  Assert(num_values <= MAX_BATCH_VALUES);
+  batch_sums(sum449, sum457, value449, value457, num_tilings,
+             floats, num_floats, ints, num_ints, values, num_values);
+
+  for (int k = 0; k < num_values; k++) {
+    /* branch free, so that it can be vectorized; sums are never negative */
+    for (int j = 0; j < num_tilings; j++) {
+      long s = sum457[j] + value457[k];
+      s = (s & MaxLONGINT) + (s >> 31); /* s % MaxLONGINT, as 2^31 - 1 */
+      ccheck[j] = (int) (s >= MaxLONGINT ? s - MaxLONGINT : s);
+      index[j] = (sum449[j] + value449[k]) & mask;
+    }
+
+    /* probing has to follow the order of single calls */
+    int *t = tiles + k * stride;
+    for (int j = 0; j < num_tilings; j++) {
+      ctable->calls++;
+      t[j] = (int) (resolve_safe(ctable, index[j], ccheck[j],
+                                 sum449[j] + value449[k]) % INT_MAX);
     }
-    if (i > 10) Log.log(101, "tiles hash collision resolved after %d tryings", i);
   }
-  return j;
 }
 
-void collision_table::reset() {
-  fill(data, data + RL_MEMORY_SIZE, -1);
+/**
+ * empty the table, resolving collisions from now on (tables in shared
+ * segments are zero filled, without construction)
+ * @param zeroed entries are known to be zero (free), and are left untouched
+ * so that their pages are not backed
+ */
+void collision_table::reset(bool zeroed) {
+  if (!zeroed) memset(data(), 0, (size_t) size * sizeof(int));
+  *(int *) &safe = 1;
   calls = 0;
   clearhits = 0;
   collisions = 0;
+  overflows = 0;
+  used = 0;
+  probing = PROBING_LINEAR;
+}
+
+collision_table::collision_table()
+    : safe(1), calls(0), clearhits(0), collisions(0), overflows(0), used(0),
+      size(0), probing(PROBING_LINEAR), dataOffset(0), dirtyOffset(0),
+      frozen(0), concurrent(0) {
 }
 
-collision_table::collision_table() : safe(1) {
-  int tmp = RL_MEMORY_SIZE;
+/**
+ * attach the table to n entries living in the same (shared) segment as this
+ * @param entries
+ * @param n
+ */
+void collision_table::attach(int *entries, int n) {
+  int tmp = n;
   while (tmp > 2) {
     if (tmp % 2 != 0) {
-      printf("\nSize of collision table must be power of 2 %d", RL_MEMORY_SIZE);
+      printf("\nSize of collision table must be power of 2 %d", n);
       exit(0);
     }
     tmp /= 2;
   }
 
-  reset();
+  size = n;
+  dataOffset = (char *) entries - (char *) this;
+}
+
+/**
+ * track dirty pages (of pages(size) bytes) living in the same segment as this
+ * @param pages
+ */
+void collision_table::attachDirty(unsigned char *pages) {
+  dirtyOffset = pages ? (char *) pages - (char *) this : 0;
 }
 
 collision_table::~collision_table() {
@@ -222,8 +767,8 @@ collision_table::~collision_table() {
 
 int collision_table::usage() {
   int count = 0;
-  for (int i = 0; i < RL_MEMORY_SIZE; i++)
-    if (data[i] != -1)
+  for (int i = 0; i < size; i++)
+    if (data()[i] != 0)
       count++;
   return count;
 }
@@ -233,15 +778,78 @@ void collision_table::save(std::ostream &ofs) {
   ofs.write((char *) &calls, sizeof(long));
   ofs.write((char *) &clearhits, sizeof(long));
   ofs.write((char *) &collisions, sizeof(long));
-  ofs.write((char *) data, RL_MEMORY_SIZE * sizeof(long));
+  ofs.write((char *) data(), size * sizeof(int));
 }
 
-void collision_table::restore(std::istream &ifs) {
+/**
+ * restore from a stream written by save (with 64-bit entries if wide, as
+ * before entries were 32-bit, and check values as they are if legacy);
+ * probing is up to the caller
+ */
+void collision_table::restore(std::istream &ifs, bool wide, bool legacy) {
   ifs.read((char *) &safe, sizeof(int));
   ifs.read((char *) &calls, sizeof(long));
   ifs.read((char *) &clearhits, sizeof(long));
   ifs.read((char *) &collisions, sizeof(long));
-  ifs.read((char *) data, RL_MEMORY_SIZE * sizeof(long));
+  readEntries(ifs, 0, size, wide, legacy);
+  overflows = 0;
+  used = usage();
+}
+
+/**
+ * restore from entries (64-bit if wide, check values as they are if legacy)
+ * and stats kept elsewhere (e.g. a mapped weight file); probing is up to the
+ * caller
+ */
+void collision_table::restore(const void *entries, bool wide, bool legacy,
+                              int safe_, long calls_, long clearhits_,
+                              long collisions_) {
+  restoreStats(safe_, calls_, clearhits_, collisions_);
+  if (wide) { // wide entries are legacy
+    const long *e = (const long *) entries;
+    for (int i = 0; i < size; i++)
+      data()[i] = (int) e[i] + 1; // check values are below 2^31 - 1
+  } else if (legacy) {
+    const int *e = (const int *) entries;
+    for (int i = 0; i < size; i++)
+      data()[i] = e[i] + 1; // -1 (free) becomes 0
+  } else {
+    memcpy(data(), entries, size * sizeof(int));
+  }
+  overflows = 0;
+  used = usage();
+}
+
+/**
+ * read n entries from first (64-bit if wide, check values as they are if
+ * legacy) without updating stats
+ */
+void collision_table::readEntries(std::istream &ifs, long first, int n,
+                                  bool wide, bool legacy) {
+  int *e = data() + first;
+  if (!wide) {
+    ifs.read((char *) e, (long) n * sizeof(int));
+    if (legacy) {
+      for (int k = 0; k < n; k++) e[k] += 1; // -1 (free) becomes 0
+    }
+    return;
+  }
+
+  long buf[1024];
+  for (int i = 0; i < n; i += 1024) {
+    int m = std::min(1024, n - i);
+    ifs.read((char *) buf, (long) m * sizeof(long));
+    for (int k = 0; k < m; k++)
+      e[i + k] = (int) buf[k] + 1; // wide entries are legacy
+  }
+}
+
+void collision_table::restoreStats(int safe_, long calls_, long clearhits_,
+                                   long collisions_) {
+  *(int *) &safe = safe_;
+  calls = calls_;
+  clearhits = clearhits_;
+  collisions = collisions_;
 }
 
 int i_tmp_arr[MAX_NUM_VARS];
@@ -319,6 +927,23 @@ void GetTiles1(int tiles[], int nt, collision_table *ct, float f1, int h1) {
   GetTiles(tiles, nt, ct, f_tmp_arr, 1, i_tmp_arr, 1);
 }
 
+// one float, a batch of first ints, two more ints
+void GetTiles1Batch(int tiles[], int stride, int nt, int memory, float f1,
+                    const int h1s[], int n, int h2, int h3) {
+  f_tmp_arr[0] = f1;
+  i_tmp_arr[1] = h2;
+  i_tmp_arr[2] = h3;
+  GetTilesBatch(tiles, stride, nt, memory, f_tmp_arr, 1, i_tmp_arr, 3, h1s, n);
+}
+
+void GetTiles1Batch(int tiles[], int stride, int nt, collision_table *ct, float f1,
+                    const int h1s[], int n, int h2, int h3) {
+  f_tmp_arr[0] = f1;
+  i_tmp_arr[1] = h2;
+  i_tmp_arr[2] = h3;
+  GetTilesBatch(tiles, stride, nt, ct, f_tmp_arr, 1, i_tmp_arr, 3, h1s, n);
+}
+
 // one float, two ints
 void GetTiles1(int tiles[], int nt, int memory, float f1, int h1, int h2) {
   f_tmp_arr[0] = f1;
@@ -8,27 +8,84 @@
 #include "SoccerTypes.h"
 
 #define MAX_NUM_VARS 64        // Maximum number of variables in a grid-tiling
+#define MAX_NUM_TILINGS 1024   // Maximum number of tilings in a batched call
+#define MAX_BATCH_VALUES MAX_RL_ACTIONS // Maximum batch size of batched calls
 #define MaxLONGINT 2147483647
 
+// Entries hold the 32-bit check values of tiles plus one (0 if free, so that
+// zero filled tables are empty); the entry a tile resolves to is its index.
+// Files written before hold check values as they are (-1 if free), and are
+// converted on load (legacy).  Collisions are resolved by linear probing
+// of at most PROBE_LIMIT entries (a few cache lines), or by double hashing in
+// tables saved before (PROBING_DOUBLE), so that their tiles resolve as they
+// did.  A tile finding no entry within the limit shares its home entry
+// (counted in overflows) instead of failing.
 class collision_table {
 public:
   collision_table();
 
   ~collision_table();
 
-  long data[RL_MEMORY_SIZE];
+  enum Probing {
+    PROBING_DOUBLE = 0, // double hashing (tables of older weight files)
+    PROBING_LINEAR = 1
+  };
+
   const int safe;
   long calls;
   long clearhits;
-  long collisions;
+  long collisions;   // probes beyond the home entry
+  long overflows;    // lookups sharing their home entry since probing failed
+  long used;         // entries in use
+  int size;          // number of entries, power of 2
+  int probing;
+  long dataOffset;   // offset of the entries relative to this (shareable among processes)
+  long dirtyOffset;  // offset of the map of dirty pages of entries (0 if not tracked)
+  int frozen;        // lookups do not insert (missing entries resolve to a free entry)
+  int concurrent;    // shared by concurrent learners: entries are claimed atomically
+
+  static const int PAGE_BITS = 4; // entries per dirty page: 1 << PAGE_BITS
+  static const int PROBE_LIMIT = 32; // linear probes beyond the home entry
+
+  int *data() { return (int *) ((char *) this + dataOffset); }
+
+  unsigned char *dirty() {
+    return dirtyOffset ? (unsigned char *) this + dirtyOffset : 0;
+  }
+
+  // mark the page of entry j (or of the weight of tile j) as dirty
+  void touch(long j) {
+    if (dirtyOffset) ((unsigned char *) this + dirtyOffset)[j >> PAGE_BITS] = 1;
+  }
+
+  static int pages(int n) { return (n + (1 << PAGE_BITS) - 1) >> PAGE_BITS; }
+
+  double loadFactor() const { return size ? (double) used / size : 0.0; }
 
-  void reset();
+  // entries probed per lookup
+  double probeLength() const {
+    return calls ? 1.0 + (double) collisions / calls : 0.0;
+  }
+
+  void attach(int *entries, int n);
+
+  void attachDirty(unsigned char *pages);
+
+  void reset(bool zeroed = false);
 
   int usage();
 
   void save(std::ostream &ofs);
 
-  void restore(std::istream &ifs);
+  void restore(std::istream &ifs, bool wide, bool legacy);
+
+  void restore(const void *entries, bool wide, bool legacy, int safe_,
+               long calls_, long clearhits_, long collisions_);
+
+  void restoreStats(int safe_, long calls_, long clearhits_, long collisions_);
+
+  void readEntries(std::istream &ifs, long first, int n, bool wide,
+                   bool legacy);
 };
 
 void GetTiles(
@@ -69,6 +126,34 @@ void GetTilesWrap(
     int ints[],          // array of integer variables
     int num_ints);             // number of integer variables
 
+// Tiles for a batch of values of the first integer variable (ints[0] is
+// ignored), sharing quantization and hashing of all other coordinates.
+// Tiles of values[k] are returned in tiles[k * stride ...], identical to
+// those of separate GetTiles calls made in the same order.
+void GetTilesBatch(
+    int tiles[],               // provided array contains returned tiles (tile indices)
+    int stride,                // distance between the tiles of consecutive values
+    int num_tilings,           // number of tile indices to be returned per value
+    int memory_size,           // total number of possible tiles
+    float floats[],            // array of floating point variables
+    int num_floats,            // number of floating point variables
+    int ints[],                // array of integer variables
+    int num_ints,              // number of integer variables
+    const int values[],        // values taken by the first integer variable
+    int num_values);           // number of values
+
+void GetTilesBatch(
+    int tiles[],               // provided array contains returned tiles (tile indices)
+    int stride,                // distance between the tiles of consecutive values
+    int num_tilings,           // number of tile indices to be returned per value
+    collision_table *ctable,   // total number of possible tiles
+    float floats[],            // array of floating point variables
+    int num_floats,            // number of floating point variables
+    int ints[],                // array of integer variables
+    int num_ints,              // number of integer variables
+    const int values[],        // values taken by the first integer variable
+    int num_values);           // number of values
+
 // no ints
 void GetTilesWrap(int tiles[], int num_tilings, int memory_size, float floats[],
                   int num_floats, int wrap_widths[]);
@@ -108,6 +193,13 @@ void GetTiles1(int tiles[], int nt, int memory, float f1, int h1);
 
 void GetTiles1(int tiles[], int nt, collision_table *ct, float f1, int h1);
 
+// one float, a batch of first ints, two more ints
+void GetTiles1Batch(int tiles[], int stride, int nt, int memory, float f1,
+                    const int h1s[], int n, int h2, int h3);
+
+void GetTiles1Batch(int tiles[], int stride, int nt, collision_table *ct, float f1,
+                    const int h1s[], int n, int h2, int h3);
+
 // one float, two ints
 void GetTiles1(int tiles[], int nt, int memory, float f1, int h1, int h2);
 
@@ -19,8 +19,10 @@ QFILE="Q"
 KEEPERQFILE2=""
 TAKERQFILE2=""
 MEMORYCHECK=""
+POOL=""
+GAME="1"
 
-while getopts  "b:g:L:A:K:T:I:lfmsnzMQ" flag; do
+while getopts  "b:g:L:A:K:T:I:W:G:lfmsnzMQ" flag; do
     case "$flag" in
         f) FULLSTATE="--fullstate" ;; 
         m) MONITOR="--monitor" ;;
@@ -37,6 +39,8 @@ while getopts  "b:g:L:A:K:T:I:lfmsnzMQ" flag; do
         K) KEEPERQFILE2="$OPTARG" ;;
         T) TAKERQFILE2="$OPTARG" ;;
         M) MEMORYCHECK="--memory-check" ;;
+        W) POOL="$OPTARG" ;; # weight pool shared with concurrent games
+        G) GAME="$OPTARG" ;; # index of this game in the pool
     esac
 done
 
@@ -70,7 +74,13 @@ if [ ! -z $QLEARNING ]; then
     QFILE="${QFILE}_ql"
 fi
 
-QFILE="${QFILE}.gz"
+WEIGHTPOOL=""
+if [ ! -z $POOL ]; then
+    WEIGHTPOOL="--weight-pool=$POOL"
+    QFILE="${QFILE}_${POOL}g${GAME}"
+fi
+
+QFILE="${QFILE}.kwq"
 KEEPERQFILE="keeper_$QFILE"
 TAKERQFILE="taker_$QFILE"
 
@@ -86,7 +96,7 @@ if [ $BUILD != "none" ]; then
     make -j `nproc` $BUILD
 fi
 
-CONSOLE_LOG="$LOGDIR/`basename $QFILE .gz`.console"
+CONSOLE_LOG="$LOGDIR/`basename $QFILE .kwq`.console"
 
 ulimit -c unlimited
 ./keepaway.py --keeper-count=3 --taker-count=2 \
@@ -96,5 +106,5 @@ ulimit -c unlimited
     $SYNCH $MONITOR $FULLSTATE $LOG $PORT \
     $HIERARCHICALFSM --gamma=$GAMMA --lambd=$LAMBDA --alpha=$ALPHA \
     --initial-weight=$INITIALWEIGHT \
-    $QLEARNING --label=`basename $QFILE .gz` 2>&1 | tee $CONSOLE_LOG
+    $QLEARNING $WEIGHTPOOL --label=`basename $QFILE .kwq` 2>&1 | tee $CONSOLE_LOG
 
@@ -0,0 +1,456 @@
+/*
+  keepaway_bench: microbenchmarks of the learner hot path (joint decisions,
+  tile coding, Q values, weight and trace updates, collision table hashing)
+  on synthetic keeper states and machine states, in process (no server and
+  no shared memory peers needed)
+
+  usage: keepaway_bench [options]
+    -K keepers          number of keepers [3]
+    -T takers           number of takers (at least 2) [2]
+    -M size             number of weights [RL_MEMORY_SIZE]
+    -F                  single precision weights
+    -H                  back learner memory by huge pages
+    -L lambda           trace decay [0.5]
+    -n ops              operations per repetition [10000]
+    -r reps             repetitions (the fastest is reported) [3]
+    -b name             only run benchmark name (may be repeated)
+
+  One JSON object per benchmark is written to stdout, e.g.
+    {"bench":"step","ops":10000,"ns_per_op":1520.3,"allocs_per_op":0,
+     "cache_misses_per_op":12.5,"l1d_misses_per_op":80.1,...}
+  Cache miss counters are null where perf_event_open is not available.
+  The state of the collision table after all benchmarks is written last, as
+    {"bench":"collision_table","load_factor":0.01,"probe_length":1.02,...}
+  followed by the pages backing learner memory, as
+    {"bench":"pages","page_size":4096,"resident":...,"huge":...,...}
+*/
+
+#include "HierarchicalFSM.h"
+#include "LinearSarsaLearner.h"
+#include <chrono>
+#include <atomic>
+#include <random>
+#include <new>
+#include <climits>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+using namespace fsm;
+
+static std::atomic<long> allocations(0);
+
+void *operator new(size_t n) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new[](size_t n) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void *p = malloc(n ? n : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete[](void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+/**
+ * hardware counter of this thread (user space only), if available
+ */
+class PerfCounter {
+public:
+  PerfCounter(unsigned type, unsigned long config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  ~PerfCounter() {
+    if (fd != -1) close(fd);
+  }
+
+  bool available() const { return fd != -1; }
+
+  void start() {
+    if (fd == -1) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  long stop() {
+    if (fd == -1) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    uint64_t count = 0;
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+    return (long) count;
+  }
+
+private:
+  int fd;
+};
+
+/**
+ * a joint machine state of the keepers and the number of choices of each
+ */
+struct SyntheticMachineState {
+  int joint;
+  num_choice_t numChoices;
+};
+
+namespace fsm {
+
+/**
+ * drives private parts of the learner
+ */
+class LearnerBench {
+public:
+  LearnerBench(int num_keepers, int num_takers, int num_states, int seed);
+
+  void hashSafe(long i) {
+    sink += hash_safe(coordinates[i & mask].data(), 5, learner.colTab);
+  }
+
+  void loadTiles(long i) {
+    auto &m = machineStates[i % machineStates.size()];
+    learner.numTilings =
+        learner.loadTiles(states[i & mask].data(), m.joint, m.numChoices,
+                          learner.tiles_);
+  }
+
+  void computeQ(long i) {
+    sink += learner.computeQ((int) (i % numValid), learner.tiles_,
+                             learner.numTilings);
+  }
+
+  void step(long i) {
+    if (i % episodeLength == 0) { // new episode
+      learner.lastJointChoiceIdx = -1;
+      learner.lastJointChoiceTime = UnknownTime;
+    }
+
+    auto &m = machineStates[i % machineStates.size()];
+    copy(states[i & mask].begin(), states[i & mask].end(), Memory::ins().state);
+    learner.jointMachineState = m.joint;
+    learner.numChoices = m.numChoices;
+    learner.lastJointChoiceIdx = learner.step((int) i + 1);
+    learner.lastJointChoiceTime = (int) i + 1;
+  }
+
+  void updateWeights(long) { learner.updateWeights(1.0e-9, learner.numTilings); }
+
+  /**
+   * decay as step does, then set the traces of one choice again, so that the
+   * trace population stays and compactions are amortized into the result
+   */
+  void decayTraces(long i) {
+    learner.decayTraces(learner.gamma * learner.lambda);
+    if (traced.empty()) return;
+    for (int j = 0; j < learner.numTilings; ++j) {
+      learner.setTrace(traced[(i * learner.numTilings + j) % traced.size()],
+                       1.0);
+    }
+  }
+
+  /**
+   * remember the features traced by the last decisions, for decayTraces
+   */
+  void prepareTraces() {
+    traced.assign(learner.nonzeroTraces,
+                  learner.nonzeroTraces + learner.numNonzeroTraces);
+  }
+
+  /**
+   * tiles of the first state, for computeQ
+   */
+  void prepareQ() {
+    loadTiles(0);
+    numValid = JointChoices(machineStates[0].numChoices).size();
+  }
+
+  int numTraces() const { return learner.numNonzeroTraces; }
+
+  int numTilings() const { return learner.numTilings; }
+
+  const collision_table &colTab() const { return *learner.colTab; }
+
+  const void *sharedData() const { return learner.sharedData; }
+
+  double sink;
+
+private:
+  static const int episodeLength = 50;
+
+  LinearSarsaLearner &learner;
+  long mask;
+  vector<vector<double>> states;
+  vector<vector<int>> coordinates;
+  vector<SyntheticMachineState> machineStates;
+  vector<int> traced;
+  int numValid;
+};
+
+}
+
+/**
+ * state variables as laid out by WorldModel::playerStateRangesAndResolutions
+ */
+static int stateRanges(int numK, int numT, double ranges[],
+                       double resolutions[]) {
+  double maxRange = hypot(25, 25);
+  int j = 0;
+
+  ranges[j] = maxRange / 2.0;
+  resolutions[j++] = 2.0;
+  for (int i = 1; i < numK; i++) {
+    ranges[j] = maxRange;
+    resolutions[j++] = 2.0 + (i - 1) / (numK - 1);
+  }
+  for (int i = 0; i < numT; i++) {
+    ranges[j] = maxRange;
+    resolutions[j++] = 3.0 + (i - 1) / (numT - 1);
+  }
+  for (int i = 1; i < numK; i++) {
+    ranges[j] = maxRange / 2.0;
+    resolutions[j++] = 2.0 + (i - 1) / (numK - 1);
+  }
+  for (int i = 0; i < numT; i++) {
+    ranges[j] = maxRange / 2.0;
+    resolutions[j++] = 3.0;
+  }
+  for (int i = 1; i < numK; i++) {
+    ranges[j] = maxRange / 2.0;
+    resolutions[j++] = 4.0;
+  }
+  for (int i = 1; i < numK; i++) {
+    ranges[j] = 180;
+    resolutions[j++] = 10.0;
+  }
+  ranges[j] = maxRange;
+  resolutions[j++] = 1.0;
+  ranges[j] = maxRange / 2.0;
+  resolutions[j++] = 2.0;
+
+  return j;
+}
+
+static stack_id_t makeStack(std::initializer_list<const char *> frames) {
+  stack_id_t s = EMPTY_STACK;
+  for (auto f : frames) {
+    s = MachineStateTable::ins().push(s, MachineStateTable::ins().frame(f));
+  }
+  return s;
+}
+
+LearnerBench::LearnerBench(int num_keepers, int num_takers, int num_states,
+                           int seed)
+    : sink(0.0), learner(LinearSarsaLearner::ins()), mask(num_states - 1),
+      numValid(1) {
+  std::mt19937 rng((unsigned) seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  double ranges[MAX_RL_STATE_VARS], resolutions[MAX_RL_STATE_VARS];
+  int numFeatures = stateRanges(num_keepers, num_takers, ranges, resolutions);
+  states.resize((size_t) num_states);
+  for (auto &s : states) {
+    for (int v = 0; v < numFeatures; ++v) s.push_back(ranges[v] * unit(rng));
+  }
+
+  // coordinates as hashed by GetTiles1Batch: one float, three ints, tiling
+  coordinates.resize((size_t) num_states);
+  for (auto &c : coordinates) {
+    c = {(int) (unit(rng) * 64), (int) (unit(rng) * 32),
+         (int) (unit(rng) * numFeatures), (int) (rng() % INT_MAX),
+         (int) (unit(rng) * 32)};
+  }
+
+  // the ball holder passing, holding or choosing whom to pass to, while the
+  // others stay or move to one of four spots
+  vector<pair<stack_id_t, int>> holder = {
+      {makeStack({"{", "@Ball"}), 2},
+      {makeStack({"{", "@Ball", "$Pass", "@PassTo"}), num_keepers - 1},
+      {makeStack({"{", "@Ball", "$Pass", "@PassSpeed"}), 2}};
+  vector<pair<stack_id_t, int>> others = {
+      {makeStack({"{", "@Free"}), 2},
+      {makeStack({"{", "@Free", "$Move", "@MoveTo"}), 4},
+      {makeStack({"{", "@Free", "$Stay"}), 1}};
+  for (size_t h = 0; h < holder.size(); ++h) {
+    for (size_t o = 0; o < others.size(); ++o) {
+      machine_state_t m;
+      SyntheticMachineState sm;
+      m.push_back(holder[h].first);
+      sm.numChoices.push_back(holder[h].second);
+      for (int k = 1; k < num_keepers; ++k) {
+        auto &other = others[(o + k) % others.size()];
+        m.push_back(other.first);
+        sm.numChoices.push_back(other.second);
+      }
+      sm.joint = MachineStateTable::ins().joint(m);
+      machineStates.push_back(sm);
+    }
+  }
+}
+
+struct BenchOptions {
+  long ops;
+  int reps;
+  vector<string> only;
+  string params; // JSON fields describing the setup
+};
+
+template<class F>
+static void run(const char *name, const BenchOptions &options, F f,
+                const string &extra = "") {
+  if (!options.only.empty() &&
+      find(options.only.begin(), options.only.end(), name) ==
+      options.only.end())
+    return;
+
+  PerfCounter cacheMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  PerfCounter l1dMisses(PERF_TYPE_HW_CACHE,
+                        PERF_COUNT_HW_CACHE_L1D |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+
+  long ops = options.ops;
+  for (long i = 0; i < ops / 10; ++i) f(i); // warm up
+
+  double best = -1.0;
+  long bestAllocs = 0, bestCacheMisses = -1, bestL1dMisses = -1;
+  for (int r = 0; r < options.reps; ++r) {
+    long allocs = allocations.load();
+    cacheMisses.start();
+    l1dMisses.start();
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i < ops; ++i) f(i);
+    auto end = chrono::steady_clock::now();
+    long c = cacheMisses.stop();
+    long l = l1dMisses.stop();
+    allocs = allocations.load() - allocs;
+
+    double ns = chrono::duration<double, std::nano>(end - start).count();
+    if (best < 0.0 || ns < best) {
+      best = ns;
+      bestAllocs = allocs;
+      bestCacheMisses = c;
+      bestL1dMisses = l;
+    }
+  }
+
+  auto perOp = [ops](long n) {
+    return n < 0 ? string("null") : to_string((double) n / ops);
+  };
+  printf("{\"bench\":\"%s\",\"ops\":%ld,\"reps\":%d,\"ns_per_op\":%.2f,"
+         "\"allocs_per_op\":%s,\"cache_misses_per_op\":%s,"
+         "\"l1d_misses_per_op\":%s%s%s}\n",
+         name, ops, options.reps, best / ops, perOp(bestAllocs).c_str(),
+         perOp(bestCacheMisses).c_str(), perOp(bestL1dMisses).c_str(),
+         options.params.c_str(), extra.c_str());
+  fflush(stdout);
+}
+
+static void usage(const char *name) {
+  cerr << "usage: " << name << " [-K keepers] [-T takers] [-M size] [-F] [-H]"
+       << " [-L lambda] [-n ops] [-r reps] [-b bench]..." << endl;
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  int numKeepers = 3;
+  int numTakers = 2;
+  int memorySize = RL_MEMORY_SIZE;
+  bool singlePrecision = false;
+  bool hugePages = false;
+  double lambda = 0.5;
+  BenchOptions options;
+  options.ops = 10000;
+  options.reps = 3;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "K:T:M:FHL:n:r:b:")) != -1) {
+    switch (opt) {
+      case 'K': numKeepers = atoi(optarg); break;
+      case 'T': numTakers = atoi(optarg); break;
+      case 'M': memorySize = atoi(optarg); break;
+      case 'F': singlePrecision = true; break;
+      case 'H': hugePages = true; break;
+      case 'L': lambda = atof(optarg); break;
+      case 'n': options.ops = atol(optarg); break;
+      case 'r': options.reps = atoi(optarg); break;
+      case 'b': options.only.push_back(optarg); break;
+      default: usage(argv[0]);
+    }
+  }
+  if (numKeepers < 2 || numKeepers > 11 || numTakers < 2 ||
+      options.ops <= 0 || options.reps <= 0)
+    usage(argv[0]);
+
+  double ranges[MAX_RL_STATE_VARS], widths[MAX_RL_STATE_VARS];
+  int numFeatures = stateRanges(numKeepers, numTakers, ranges, widths);
+  Precision precision = singlePrecision ? PRECISION_FLOAT : PRECISION_DOUBLE;
+
+  LinearSarsaLearner::setInProcess(true); // no shared memory needed
+  LinearSarsaLearner::setHugePages(hugePages);
+  LinearSarsaLearner::setSeed(1);
+  HierarchicalFSM::initialize(numFeatures, numKeepers, numTakers, true, widths,
+                              1.0, lambda, 0.125, 0.0, false, "", "",
+                              "keepers", memorySize, precision);
+  Memory::ins().agentIdx = 0;
+  for (int i = 0; i < numKeepers; ++i) {
+    Memory::ins().teammates[i] = SoccerTypes::getTeammateObjectFromIndex(i);
+  }
+
+  LearnerBench bench(numKeepers, numTakers, 4096, 1);
+
+  options.params = ",\"keepers\":" + to_string(numKeepers) +
+                   ",\"takers\":" + to_string(numTakers) +
+                   ",\"features\":" + to_string(numFeatures) +
+                   ",\"memory_size\":" + to_string(memorySize) +
+                   ",\"precision\":" + to_string((int) precision) +
+                   ",\"huge_pages\":" + to_string((int) hugePages) +
+                   ",\"lambda\":" + to_string(lambda);
+
+  run("hash_safe", options, [&](long i) { bench.hashSafe(i); });
+  bench.prepareQ();
+  run("loadTiles", options, [&](long i) { bench.loadTiles(i); },
+      ",\"tilings\":" + to_string(bench.numTilings()));
+  bench.prepareQ();
+  run("computeQ", options, [&](long i) { bench.computeQ(i); });
+  run("step", options, [&](long i) { bench.step(i); });
+
+  // weight and trace updates with the traces left by the last decisions
+  string traces = ",\"traces\":" + to_string(bench.numTraces());
+  run("updateWeights", options, [&](long i) { bench.updateWeights(i); },
+      traces);
+  bench.prepareTraces();
+  run("decayTraces", options, [&](long i) { bench.decayTraces(i); }, traces);
+
+  const collision_table &ct = bench.colTab();
+  printf("{\"bench\":\"collision_table\",\"load_factor\":%.6f,"
+         "\"probe_length\":%.4f,\"overflows\":%ld%s}\n",
+         ct.loadFactor(), ct.probeLength(), ct.overflows,
+         options.params.c_str());
+
+  long pageSize, resident, huge;
+  LinearSarsaLearner::pageStats(bench.sharedData(), pageSize, resident, huge);
+  printf("{\"bench\":\"pages\",\"page_size\":%ld,\"resident\":%ld,"
+         "\"huge\":%ld%s}\n", pageSize, resident, huge,
+         options.params.c_str());
+
+  fprintf(stderr, "sink: %g\n", bench.sink); // keeps the results alive
+  return 0;
+}
@@ -0,0 +1,104 @@
+/*
+  kwcompact: merge a full weight file (e.g. a full checkpoint) and the delta
+  checkpoints following it into a full weight file
+
+  usage: kwcompact output base [delta ...]
+
+  The output is written in the uncompressed (mapped) format, or in the
+  compressed format if its name ends with .gz.
+*/
+
+#include "Checkpointer.h"
+#include "gzstream.h"
+
+using namespace fsm;
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " output base [delta ...]" << endl;
+    return 1;
+  }
+
+  const char *output = argv[1];
+  const char *base = argv[2];
+
+  int memorySize = 0;
+  Precision precision = PRECISION_DOUBLE;
+  int numFeatures = 0;
+  double widths[MAX_RL_STATE_VARS] = {};
+
+  MappedWeightsHeader mappedHeader;
+  WeightsHeader header;
+  bool mapped = LinearSarsaLearner::peekMappedWeights(base, mappedHeader);
+  if (mapped) {
+    memorySize = mappedHeader.memorySize;
+    precision = (Precision) mappedHeader.precision;
+    numFeatures = mappedHeader.numFeatures;
+    copy(mappedHeader.tileWidths, mappedHeader.tileWidths + numFeatures,
+         widths);
+  } else if (LinearSarsaLearner::peekWeights(base, header)) {
+    memorySize = header.memorySize;
+    precision = (Precision) header.precision;
+  } else {
+    cerr << "failed to open weight file: " << base << endl;
+    return 1;
+  }
+
+  if (precision == PRECISION_INT16) {
+    cerr << "quantized weight files are inference only: " << base << endl;
+    return 1;
+  }
+
+  vector<char> buffer((size_t) memorySize * precision);
+  vector<int> entries((size_t) memorySize);
+  RealArray weights; // stored relative to the offset of a mapped base
+  weights.attach(buffer.data(), precision, 1.0,
+                 mapped ? mappedHeader.offset : 0.0);
+  collision_table colTab;
+  colTab.attach(entries.data(), memorySize);
+
+  if (mapped) {
+    const char *file = LinearSarsaLearner::mapWeights(base, mappedHeader);
+    if (!file) return 1;
+    memcpy(buffer.data(), file + mappedHeader.weightsOffset, buffer.size());
+    mappedHeader.restoreColTab(file, colTab);
+    munmap((void *) file, (size_t) mappedHeader.fileSize);
+  } else {
+    igzstream is;
+    is.open(base);
+    if (!LinearSarsaLearner::readWeights(is, weights, memorySize, &colTab)) {
+      return 1;
+    }
+    is.close();
+  }
+
+  for (int i = 3; i < argc; ++i) {
+    if (!Checkpointer::applyDelta(argv[i], weights, memorySize, &colTab)) {
+      return 1;
+    }
+  }
+
+  string name = output;
+  if (name.length() >= 3 && name.compare(name.length() - 3, 3, ".gz") == 0) {
+    ogzstream os;
+    os.open(output);
+    if (!os.good()) {
+      cerr << "failed to open weight file: " << output << endl;
+      return 1;
+    }
+    LinearSarsaLearner::writeWeights(os, buffer.data(), memorySize, precision,
+                                     &colTab, weights.getOffset());
+    os.close();
+    if (!os.good()) {
+      cerr << "failed to write weight file: " << output << endl;
+      return 1;
+    }
+  } else if (!LinearSarsaLearner::writeMappedWeights(
+      output, buffer.data(), memorySize, precision, numFeatures, widths,
+      &colTab, 1.0, weights.getOffset())) {
+    return 1;
+  }
+
+  cerr << "Merged " << argc - 3 << " deltas into " << output << endl;
+  return 0;
+}
@@ -0,0 +1,140 @@
+/*
+  kwlogdump: print the learner events recorded by the players
+  (keepaway.py --record-events) as text or CSV
+
+  usage: kwlogdump [options] log...
+    -c                  CSV (one column per field, lists joined by ';')
+    -a agent            events of agent (uniform number) only
+    -s cycle            events from cycle on
+    -e cycle            events up to cycle
+    -t type             events of type only (repeatable): episode_start,
+                        choice_point, joint_choice, q_values, update,
+                        barrier_wait, episode_end
+
+  Blocks of other agents, cycles or types are skipped without inflating them.
+*/
+
+#include "EventLog.h"
+#include <iostream>
+#include <climits>
+#include <unistd.h>
+
+using namespace std;
+using namespace fsm;
+
+static void usage(const char *name) {
+  cerr << "usage: " << name << " [-c] [-a agent] [-s cycle] [-e cycle]"
+       << " [-t type]... log..." << endl;
+  exit(1);
+}
+
+static void printList(const vector<double> &list, char sep) {
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (i) putchar(sep);
+    printf("%g", list[i]);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool csv = false;
+  int agent = 0;
+  int first = INT_MIN, last = INT_MAX;
+  uint32_t types = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "ca:s:e:t:")) != -1) {
+    switch (opt) {
+      case 'c': csv = true; break;
+      case 'a': agent = atoi(optarg); break;
+      case 's': first = atoi(optarg); break;
+      case 'e': last = atoi(optarg); break;
+      case 't': {
+        int type = EventSchema::named(optarg);
+        if (!type) {
+          cerr << "unknown event type: " << optarg << endl;
+          return 1;
+        }
+        types |= 1u << type;
+        break;
+      }
+      default: usage(argv[0]);
+    }
+  }
+  if (optind >= argc) usage(argv[0]);
+  if (!types) types = ~0u;
+
+  // several types share generic columns: shorter rows are padded to them
+  int single = __builtin_popcount(types) == 1 ? __builtin_ctz(types) : 0;
+  int columns = single ? EventSchema::of(single).numFields
+                       : EventSchema::MAX_FIELDS;
+  if (csv) {
+    printf("agent,cycle,event");
+    const EventSchema &schema = EventSchema::of(single);
+    if (single) {
+      for (int i = 0; i < schema.numFields; ++i) {
+        printf(",%s", schema.fields[i]);
+      }
+    } else {
+      for (int i = 0; i < EventSchema::MAX_FIELDS; ++i) printf(",f%d", i + 1);
+    }
+    printf("\n");
+  }
+
+  long blocks = 0, inflated = 0, events = 0;
+  EventLog log;
+  EventBlockHeader block;
+  vector<EventRecord> records;
+  for (int i = optind; i < argc; ++i) {
+    if (!log.openRead(argv[i])) return 1;
+
+    while (log.nextBlock(block)) {
+      blocks += 1;
+      if ((agent && block.agent != agent) || block.lastCycle < first ||
+          block.firstCycle > last || !(block.types & types)) {
+        log.skipBlock(block);
+        continue;
+      }
+      inflated += 1;
+      if (!log.readBlock(block, records)) return 1;
+
+      for (auto &r : records) {
+        if (r.cycle < first || r.cycle > last || !(types & (1u << r.type)))
+          continue;
+        events += 1;
+        const EventSchema &schema = EventSchema::of(r.type);
+        if (csv) {
+          printf("%d,%d,%s", r.agent, r.cycle, schema.name);
+        } else {
+          printf("%d %d %s", r.agent, r.cycle, schema.name);
+        }
+        for (int f = 0; f < schema.numFields; ++f) {
+          if (csv) {
+            printf(",");
+          } else {
+            printf(" %s=", schema.fields[f]);
+          }
+          if (schema.kinds[f] == 'l') {
+            if (!csv) printf("[");
+            printList(r.list, csv ? ';' : ' ');
+            if (!csv) printf("]");
+          } else {
+            switch (schema.kinds[f]) {
+              case 'u': printf("%llu", (unsigned long long) r.fields[f].i); break;
+              case 's': printf("%lld", (long long) r.fields[f].i); break;
+              default: printf("%g", r.fields[f].x);
+            }
+          }
+        }
+        if (csv) {
+          for (int f = schema.numFields; f < columns; ++f) printf(",");
+        }
+        printf("\n");
+      }
+    }
+    log.close();
+  }
+
+  cerr << events << " events from " << inflated << " of " << blocks
+       << " blocks" << endl;
+  return 0;
+}
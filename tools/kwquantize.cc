@@ -0,0 +1,190 @@
+/*
+  kwquantize: export a weight file as an inference only policy, with weights
+  quantized to int16 (weight = offset + scale * q) in the uncompressed (mapped)
+  format, a quarter of the size of double weights
+
+  usage: kwquantize output input [log...]
+
+  Reports the largest error of a weight and the resulting bound on Q errors:
+  greedy choices of the quantized policy can only differ from those of the
+  full precision one where the best two Q values are closer than twice that.
+  Given transition logs (keepaway.py --record-transitions), also counts the
+  recorded decisions whose greedy choices differ.
+*/
+
+#include "HierarchicalFSM.h"
+#include "LinearSarsaLearner.h"
+#include "gzstream.h"
+
+using namespace fsm;
+
+/**
+ * greedy choice of a decision given its tiles (the first one of ties), and
+ * the gap to the second best Q value
+ */
+static int greedy(const RealArray &weights, const TileArena &tiles, int n,
+                  int numTilings, double &gap) {
+  int best = 0;
+  double q1 = -numeric_limits<double>::infinity();
+  double q2 = q1;
+  for (int c = 0; c < n; ++c) {
+    double q = 0.0;
+    for (int j = 0; j < numTilings; ++j) {
+      q += weights[tiles[c][j]];
+    }
+    if (q > q1) {
+      q2 = q1;
+      q1 = q;
+      best = c;
+    } else if (q > q2) {
+      q2 = q;
+    }
+  }
+  gap = q1 - q2;
+  return best;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " output input [log...]" << endl;
+    return 1;
+  }
+
+  const char *output = argv[1];
+  const char *input = argv[2];
+
+  int memorySize = 0;
+  Precision precision = PRECISION_DOUBLE;
+  int numFeatures = 0;
+  double widths[MAX_RL_STATE_VARS] = {};
+
+  MappedWeightsHeader mappedHeader;
+  WeightsHeader header;
+  bool mapped = LinearSarsaLearner::peekMappedWeights(input, mappedHeader);
+  if (mapped) {
+    memorySize = mappedHeader.memorySize;
+    precision = (Precision) mappedHeader.precision;
+    numFeatures = mappedHeader.numFeatures;
+    copy(mappedHeader.tileWidths, mappedHeader.tileWidths + numFeatures,
+         widths);
+  } else if (LinearSarsaLearner::peekWeights(input, header)) {
+    memorySize = header.memorySize;
+    precision = (Precision) header.precision;
+  } else {
+    cerr << "failed to open weight file: " << input << endl;
+    return 1;
+  }
+
+  if (precision == PRECISION_INT16) {
+    cerr << "weight file is quantized already: " << input << endl;
+    return 1;
+  }
+
+  vector<char> buffer((size_t) memorySize * precision);
+  vector<int> entries((size_t) memorySize);
+  RealArray weights; // stored relative to the offset of a mapped input
+  weights.attach(buffer.data(), precision, 1.0,
+                 mapped ? mappedHeader.offset : 0.0);
+  collision_table colTab;
+  colTab.attach(entries.data(), memorySize);
+
+  if (mapped) {
+    const char *file = LinearSarsaLearner::mapWeights(input, mappedHeader);
+    if (!file) return 1;
+    memcpy(buffer.data(), file + mappedHeader.weightsOffset, buffer.size());
+    mappedHeader.restoreColTab(file, colTab);
+    munmap((void *) file, (size_t) mappedHeader.fileSize);
+  } else {
+    igzstream is;
+    is.open(input);
+    if (!LinearSarsaLearner::readWeights(is, weights, memorySize, &colTab)) {
+      return 1;
+    }
+    is.close();
+  }
+
+  // symmetric range of q around the middle of the weights
+  double lo = weights[0], hi = weights[0];
+  for (int i = 1; i < memorySize; ++i) {
+    lo = min(lo, weights[i]);
+    hi = max(hi, weights[i]);
+  }
+  double offset = (lo + hi) / 2.0;
+  double scale = hi > lo ? (hi - lo) / (2.0 * 32767) : 1.0;
+
+  vector<short> q((size_t) memorySize);
+  RealArray quantized;
+  quantized.attach(q.data(), PRECISION_INT16, scale, offset);
+  double error = 0.0;
+  for (int i = 0; i < memorySize; ++i) {
+    quantized.set(i, weights[i]);
+    error = max(error, fabs(quantized[i] - weights[i]));
+  }
+
+  if (!LinearSarsaLearner::writeMappedWeights(
+      output, q.data(), memorySize, PRECISION_INT16, numFeatures, widths,
+      &colTab, scale, offset)) {
+    return 1;
+  }
+
+  cerr << "Quantized " << memorySize << " weights in [" << lo << ", " << hi
+       << "] into " << output << ": scale " << scale << ", offset " << offset
+       << endl;
+  cerr << "Weight error at most " << error << ", Q error at most "
+       << error << " per tiling";
+  if (numFeatures > 0) {
+    int numTilings = numFeatures * mappedHeader.tilingsPerGroup;
+    cerr << " (" << numTilings * error << " for " << numTilings
+         << " tilings); greedy choices agree where the best two Q values are "
+         << "more than " << 2 * numTilings * error << " apart";
+  }
+  cerr << endl;
+
+  if (argc == 3) return 0;
+
+  TransitionLog log;
+  if (!log.openRead(argv[3])) return 1;
+  TransitionLogHeader logHeader = log.getHeader();
+  log.close();
+
+  double logWidths[MAX_RL_STATE_VARS];
+  copy(logHeader.tileWidths, logHeader.tileWidths + logHeader.numFeatures,
+       logWidths);
+
+  // tiles are coded with the collision table of the input
+  LinearSarsaLearner::setInProcess(true); // no shared memory needed
+  HierarchicalFSM::initialize(
+      logHeader.numFeatures, logHeader.numTeammates, logHeader.numOpponents,
+      false, logWidths, 1.0, 0.0, 0.0, 0.0, false, input, "",
+      logHeader.teamName, memorySize, precision);
+
+  long decisions = 0, disagreements = 0, close = 0;
+  TileArena tiles;
+  TransitionRecord record;
+  for (int i = 3; i < argc; ++i) {
+    if (!log.openRead(argv[i])) return 1;
+    if (!log.getHeader().compatible(logHeader)) {
+      cerr << "incompatible transition log: " << argv[i] << endl;
+      return 1;
+    }
+
+    while (log.read(record)) {
+      if (record.kind != TransitionRecord::STEP) continue;
+      int numTilings = LinearSarsaLearner::ins().recordTiles(record, tiles);
+      int n = JointChoices(record.numChoices).size();
+      double gap, quantizedGap;
+      int c = greedy(weights, tiles, n, numTilings, gap);
+      if (c != greedy(quantized, tiles, n, numTilings, quantizedGap)) {
+        disagreements += 1;
+      }
+      if (n > 1 && gap <= 2 * numTilings * error) close += 1;
+      decisions += 1;
+    }
+    log.close();
+  }
+
+  cerr << "Greedy choices differ in " << disagreements << " out of "
+       << decisions << " recorded decisions (at most " << close
+       << " within the bound)" << endl;
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+  kwreplay: learn offline from transition logs recorded by the players
+  (keepaway.py --record-transitions), through the same SARSA(lambda) or
+  Q-learning updates as online learning, taking the recorded choices
+
+  usage: kwreplay [options] log...
+    -g gamma            discount factor [1.0]
+    -L lambda           trace decay [0.0]
+    -A alpha            learning rate [0.125]
+    -I weight           initial weight [0.0]
+    -Q                  Q-learning instead of SARSA
+    -w file             load weights from file
+    -f file             save weights to file
+    -M size             number of weights [RL_MEMORY_SIZE]
+    -F                  single precision weights
+    -n passes           passes over the logs [1]
+*/
+
+#include "HierarchicalFSM.h"
+#include "LinearSarsaLearner.h"
+#include <chrono>
+
+using namespace fsm;
+
+static void usage(const char *name) {
+  cerr << "usage: " << name << " [-g gamma] [-L lambda] [-A alpha] [-I weight]"
+       << " [-Q] [-w load] [-f save] [-M size] [-F] [-n passes] log..."
+       << endl;
+  exit(1);
+}
+
+int main(int argc, char *argv[]) {
+  double gamma = 1.0;
+  double lambda = 0.0;
+  double alpha = 0.125;
+  double initialWeight = 0.0;
+  bool qLearning = false;
+  string loadWeightsFile;
+  string saveWeightsFile;
+  int memorySize = RL_MEMORY_SIZE;
+  bool singlePrecision = false;
+  int passes = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "g:L:A:I:Qw:f:M:Fn:")) != -1) {
+    switch (opt) {
+      case 'g': gamma = atof(optarg); break;
+      case 'L': lambda = atof(optarg); break;
+      case 'A': alpha = atof(optarg); break;
+      case 'I': initialWeight = atof(optarg); break;
+      case 'Q': qLearning = true; break;
+      case 'w': loadWeightsFile = optarg; break;
+      case 'f': saveWeightsFile = optarg; break;
+      case 'M': memorySize = atoi(optarg); break;
+      case 'F': singlePrecision = true; break;
+      case 'n': passes = atoi(optarg); break;
+      default: usage(argv[0]);
+    }
+  }
+  if (optind >= argc) usage(argv[0]);
+
+  TransitionLog log;
+  if (!log.openRead(argv[optind])) return 1;
+  TransitionLogHeader header = log.getHeader();
+  log.close();
+
+  double widths[MAX_RL_STATE_VARS];
+  copy(header.tileWidths, header.tileWidths + header.numFeatures, widths);
+
+  LinearSarsaLearner::setInProcess(true); // no shared memory needed
+  HierarchicalFSM::initialize(
+      header.numFeatures, header.numTeammates, header.numOpponents, true,
+      widths, gamma, lambda, alpha, initialWeight, qLearning, loadWeightsFile,
+      saveWeightsFile, header.teamName, memorySize,
+      singlePrecision ? PRECISION_FLOAT : PRECISION_DOUBLE);
+  Memory::ins().agentIdx = 0; // saves weights at exit
+
+  auto start = chrono::steady_clock::now();
+  long steps = 0, episodes = 0;
+  TransitionRecord record;
+  for (int pass = 0; pass < passes; ++pass) {
+    for (int i = optind; i < argc; ++i) {
+      if (!log.openRead(argv[i])) return 1;
+      if (!log.getHeader().compatible(header)) {
+        cerr << "incompatible transition log: " << argv[i] << endl;
+        return 1;
+      }
+
+      while (log.read(record)) {
+        LinearSarsaLearner::ins().replay(record);
+        if (record.kind == TransitionRecord::STEP) steps += 1;
+        else episodes += 1;
+      }
+      log.close();
+    }
+  }
+
+  double seconds = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count();
+  cerr << "Replayed " << steps << " decisions and " << episodes
+       << " episodes in " << seconds << " seconds" << endl;
+  return 0;
+}